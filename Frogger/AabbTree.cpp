@@ -0,0 +1,400 @@
+#include "AabbTree.h"
+#include <algorithm>
+
+namespace {
+	sf::FloatRect unite(const sf::FloatRect& a, const sf::FloatRect& b) {
+		float left = std::min(a.left, b.left);
+		float top = std::min(a.top, b.top);
+		float right = std::max(a.left + a.width, b.left + b.width);
+		float bottom = std::max(a.top + a.height, b.top + b.height);
+		return sf::FloatRect(left, top, right - left, bottom - top);
+	}
+
+	sf::FloatRect grow(const sf::FloatRect& r, float margin) {
+		return sf::FloatRect(r.left - margin, r.top - margin, r.width + 2.f * margin, r.height + 2.f * margin);
+	}
+
+	bool encloses(const sf::FloatRect& outer, const sf::FloatRect& inner) {
+		return outer.left <= inner.left && outer.top <= inner.top
+			&& outer.left + outer.width >= inner.left + inner.width
+			&& outer.top + outer.height >= inner.top + inner.height;
+	}
+
+	// inclusive, used to prune against fat boxes
+	bool touches(const sf::FloatRect& a, const sf::FloatRect& b) {
+		return a.left <= b.left + b.width && b.left <= a.left + a.width
+			&& a.top <= b.top + b.height && b.top <= a.top + a.height;
+	}
+
+	bool touches(const sf::FloatRect& r, sf::Vector2f p) {
+		return p.x >= r.left && p.x <= r.left + r.width && p.y >= r.top && p.y <= r.top + r.height;
+	}
+
+	float perimeter(const sf::FloatRect& r) {
+		return 2.f * (r.width + r.height);
+	}
+}
+
+
+AabbTree::AabbTree(float margin)
+	: m_margin(margin) {}
+
+
+float AabbTree::getMargin() const {
+	return m_margin;
+}
+
+
+int AabbTree::getHeight() const {
+	return m_root == Null ? 0 : m_nodes[m_root].height;
+}
+
+
+std::int32_t AabbTree::allocateNode() {
+	if (m_freeList == Null) {
+		m_nodes.emplace_back();
+		return static_cast<std::int32_t>(m_nodes.size() - 1);
+	}
+
+	auto node = m_freeList;
+	m_freeList = m_nodes[node].parent;
+	m_nodes[node] = Node{};
+	return node;
+}
+
+
+void AabbTree::freeNode(std::int32_t node) {
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+
+void AabbTree::update(EntityHandle h, const sf::FloatRect& bounds, const CollisionFilter& filter) {
+	if (h.index >= m_leaves.size())
+		m_leaves.resize(h.index + 1, Null);
+
+	// slot reused by a new entity, drop the stale leaf first
+	auto leaf = m_leaves[h.index];
+	if (leaf != Null && m_nodes[leaf].handle != h) {
+		remove(m_nodes[leaf].handle);
+		leaf = Null;
+	}
+
+	if (leaf == Null) {
+		leaf = allocateNode();
+		m_nodes[leaf].handle = h;
+		m_nodes[leaf].filter = filter;
+		m_nodes[leaf].bounds = bounds;
+		m_nodes[leaf].fat = grow(bounds, m_margin);
+		insertLeaf(leaf);
+		m_leaves[h.index] = leaf;
+		++m_count;
+		return;
+	}
+
+	m_nodes[leaf].bounds = bounds;
+	m_nodes[leaf].filter = filter;
+	if (encloses(m_nodes[leaf].fat, bounds))
+		return;
+
+	removeLeaf(leaf);
+	m_nodes[leaf].fat = grow(bounds, m_margin);
+	insertLeaf(leaf);
+}
+
+
+void AabbTree::remove(EntityHandle h) {
+	if (!contains(h))
+		return;
+
+	auto leaf = m_leaves[h.index];
+	removeLeaf(leaf);
+	freeNode(leaf);
+	m_leaves[h.index] = Null;
+	--m_count;
+}
+
+
+bool AabbTree::contains(EntityHandle h) const {
+	return h.index < m_leaves.size() && m_leaves[h.index] != Null && m_nodes[m_leaves[h.index]].handle == h;
+}
+
+
+sf::FloatRect AabbTree::getBounds(EntityHandle h) const {
+	return m_nodes[m_leaves[h.index]].bounds;
+}
+
+
+void AabbTree::clear() {
+	m_nodes.clear();
+	m_leaves.clear();
+	m_root = Null;
+	m_freeList = Null;
+	m_count = 0;
+}
+
+
+size_t AabbTree::size() const {
+	return m_count;
+}
+
+
+void AabbTree::insertLeaf(std::int32_t leaf) {
+	if (m_root == Null) {
+		m_root = leaf;
+		m_nodes[leaf].parent = Null;
+		return;
+	}
+
+	// walk down towards the cheapest sibling
+	auto box = m_nodes[leaf].fat;
+	auto index = m_root;
+	while (!m_nodes[index].isLeaf()) {
+		auto& node = m_nodes[index];
+		float area = perimeter(node.fat);
+		float combined = perimeter(unite(node.fat, box));
+
+		// cost of pairing with this node, and of pushing the leaf further down
+		float cost = 2.f * combined;
+		float inheritance = 2.f * (combined - area);
+
+		auto childCost = [&](std::int32_t child) {
+			auto& c = m_nodes[child];
+			float grown = perimeter(unite(box, c.fat));
+			return (c.isLeaf() ? grown : grown - perimeter(c.fat)) + inheritance;
+		};
+		float costLeft = childCost(node.left);
+		float costRight = childCost(node.right);
+
+		if (cost < costLeft && cost < costRight)
+			break;
+		index = costLeft < costRight ? node.left : node.right;
+	}
+
+	auto sibling = index;
+	auto oldParent = m_nodes[sibling].parent;
+	auto newParent = allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].fat = unite(box, m_nodes[sibling].fat);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].left = sibling;
+	m_nodes[newParent].right = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == Null)
+		m_root = newParent;
+	else if (m_nodes[oldParent].left == sibling)
+		m_nodes[oldParent].left = newParent;
+	else
+		m_nodes[oldParent].right = newParent;
+
+	refit(m_nodes[leaf].parent);
+}
+
+
+void AabbTree::removeLeaf(std::int32_t leaf) {
+	if (leaf == m_root) {
+		m_root = Null;
+		return;
+	}
+
+	auto parent = m_nodes[leaf].parent;
+	auto grandParent = m_nodes[parent].parent;
+	auto sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+	m_nodes[sibling].parent = grandParent;
+	freeNode(parent);
+
+	if (grandParent == Null) {
+		m_root = sibling;
+		return;
+	}
+
+	if (m_nodes[grandParent].left == parent)
+		m_nodes[grandParent].left = sibling;
+	else
+		m_nodes[grandParent].right = sibling;
+	refit(grandParent);
+}
+
+
+void AabbTree::refit(std::int32_t node) {
+	// rebalance and recompute heights and boxes up to the root
+	while (node != Null) {
+		node = balance(node);
+
+		auto& n = m_nodes[node];
+		auto& left = m_nodes[n.left];
+		auto& right = m_nodes[n.right];
+		n.height = 1 + std::max(left.height, right.height);
+		n.fat = unite(left.fat, right.fat);
+
+		node = n.parent;
+	}
+}
+
+
+std::int32_t AabbTree::balance(std::int32_t a) {
+	auto& A = m_nodes[a];
+	if (A.isLeaf() || A.height < 2)
+		return a;
+
+	auto b = A.left;
+	auto c = A.right;
+	auto& B = m_nodes[b];
+	auto& C = m_nodes[c];
+	int diff = C.height - B.height;
+
+	// rotate the taller child up into a's place
+	auto rotate = [&](std::int32_t up, std::int32_t other) {
+		auto& U = m_nodes[up];
+		auto f = U.left;
+		auto g = U.right;
+		auto& F = m_nodes[f];
+		auto& G = m_nodes[g];
+
+		U.left = a;
+		U.parent = A.parent;
+		A.parent = up;
+
+		if (U.parent == Null)
+			m_root = up;
+		else if (m_nodes[U.parent].left == a)
+			m_nodes[U.parent].left = up;
+		else
+			m_nodes[U.parent].right = up;
+
+		// the taller grandchild stays under up, the shorter one moves to a
+		bool keepF = F.height > G.height;
+		auto keep = keepF ? f : g;
+		auto move = keepF ? g : f;
+		U.right = keep;
+		if (A.left == up)
+			A.left = move;
+		else
+			A.right = move;
+		m_nodes[move].parent = a;
+
+		auto& O = m_nodes[other];
+		auto& M = m_nodes[move];
+		auto& K = m_nodes[keep];
+		A.fat = unite(O.fat, M.fat);
+		A.height = 1 + std::max(O.height, M.height);
+		U.fat = unite(A.fat, K.fat);
+		U.height = 1 + std::max(A.height, K.height);
+		return up;
+	};
+
+	if (diff > 1)
+		return rotate(c, b);
+	if (diff < -1)
+		return rotate(b, c);
+	return a;
+}
+
+
+void AabbTree::query(const sf::FloatRect& bounds, std::vector<EntityHandle>& out, const CollisionFilter& filter) {
+	if (m_root == Null)
+		return;
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while (!m_stack.empty()) {
+		auto& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+		if (!touches(node.fat, bounds))
+			continue;
+
+		if (node.isLeaf()) {
+			if (filter.accepts(node.filter) && node.bounds.intersects(bounds))
+				out.push_back(node.handle);
+		}
+		else {
+			m_stack.push_back(node.left);
+			m_stack.push_back(node.right);
+		}
+	}
+}
+
+
+void AabbTree::queryPoint(sf::Vector2f p, std::vector<EntityHandle>& out, const CollisionFilter& filter) {
+	if (m_root == Null)
+		return;
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while (!m_stack.empty()) {
+		auto& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+		if (!touches(node.fat, p))
+			continue;
+
+		if (node.isLeaf()) {
+			if (filter.accepts(node.filter) && node.bounds.contains(p))
+				out.push_back(node.handle);
+		}
+		else {
+			m_stack.push_back(node.left);
+			m_stack.push_back(node.right);
+		}
+	}
+}
+
+
+void AabbTree::queryRay(sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out, const CollisionFilter& filter) {
+	if (m_root == Null)
+		return;
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while (!m_stack.empty()) {
+		auto& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+		if (!touchesSegment(node.fat, origin, delta))
+			continue;
+
+		if (node.isLeaf()) {
+			RayHit hit;
+			if (filter.accepts(node.filter) && intersectRay(node.bounds, origin, delta, hit)) {
+				hit.handle = node.handle;
+				out.push_back(hit);
+			}
+		}
+		else {
+			m_stack.push_back(node.left);
+			m_stack.push_back(node.right);
+		}
+	}
+}
+
+
+void AabbTree::queryPairs(std::vector<Pair>& out) {
+	for (auto leaf : m_leaves) {
+		if (leaf == Null)
+			continue;
+
+		// each pair is reported by its lower numbered leaf
+		auto& bounds = m_nodes[leaf].bounds;
+		auto& filter = m_nodes[leaf].filter;
+		m_stack.clear();
+		m_stack.push_back(m_root);
+		while (!m_stack.empty()) {
+			auto index = m_stack.back();
+			auto& node = m_nodes[index];
+			m_stack.pop_back();
+			if (!touches(node.fat, bounds))
+				continue;
+
+			if (node.isLeaf()) {
+				if (index > leaf && filter.accepts(node.filter) && node.bounds.intersects(bounds))
+					out.emplace_back(m_nodes[leaf].handle, node.handle);
+			}
+			else {
+				m_stack.push_back(node.left);
+				m_stack.push_back(node.right);
+			}
+		}
+	}
+}
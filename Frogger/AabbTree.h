@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Broadphase.h"
+
+
+// Dynamic bounding volume tree. Leaves store each entity's AABB grown by a
+// margin ("fat" AABB), so an entity that moves a little stays inside it and
+// update() costs nothing; only when it leaves its fat AABB is the leaf
+// removed and reinserted. Branches are kept balanced with AVL style
+// rotations, inserts pick the sibling that grows the tree's perimeter least.
+class AabbTree : public Broadphase
+{
+private:
+	static constexpr std::int32_t Null = -1;
+
+	struct Node {
+		sf::FloatRect   fat;            // leaves: bounds plus margin, branches: union of children
+		sf::FloatRect   bounds;         // leaves only
+		EntityHandle    handle;         // leaves only
+		CollisionFilter filter;         // leaves only
+		std::int32_t    parent{ Null }; // next free node while on the free list
+		std::int32_t    left{ Null };
+		std::int32_t    right{ Null };
+		std::int32_t    height{ 0 };    // -1 while on the free list
+
+		bool isLeaf() const { return left == Null; }
+	};
+
+	float                       m_margin;
+	std::vector<Node>           m_nodes;
+	std::int32_t                m_root{ Null };
+	std::int32_t                m_freeList{ Null };
+	std::vector<std::int32_t>   m_leaves;       // EntityHandle::index -> leaf
+	size_t                      m_count{ 0 };
+	std::vector<std::int32_t>   m_stack;
+
+	std::int32_t    allocateNode();
+	void            freeNode(std::int32_t node);
+	void            insertLeaf(std::int32_t leaf);
+	void            removeLeaf(std::int32_t leaf);
+	void            refit(std::int32_t node);
+	std::int32_t    balance(std::int32_t node);
+
+public:
+	explicit AabbTree(float margin = 4.f);
+
+	float           getMargin() const;
+	int             getHeight() const;
+
+	void            update(EntityHandle h, const sf::FloatRect& bounds, const CollisionFilter& filter = {}) override;
+	void            remove(EntityHandle h) override;
+	bool            contains(EntityHandle h) const override;
+	sf::FloatRect   getBounds(EntityHandle h) const override;
+	void            clear() override;
+	size_t          size() const override;
+
+	void            query(const sf::FloatRect& bounds, std::vector<EntityHandle>& out,
+		const CollisionFilter& filter = {}) override;
+	void            queryPoint(sf::Vector2f p, std::vector<EntityHandle>& out,
+		const CollisionFilter& filter = {}) override;
+	void            queryRay(sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out,
+		const CollisionFilter& filter = {}) override;
+	void            queryPairs(std::vector<Pair>& out) override;
+};
@@ -0,0 +1,65 @@
+#include "Broadphase.h"
+#include "SpatialHash.h"
+#include "AabbTree.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+	// entry and exit times of the line origin + t * delta through box's slab
+	// on one axis; a line parallel to the slab is in it for all t or none
+	bool slab(float o, float d, float lo, float hi, float& entry, float& exit) {
+		constexpr float inf = std::numeric_limits<float>::infinity();
+		if (d == 0.f) {
+			entry = -inf;
+			exit = inf;
+			return o >= lo && o <= hi;
+		}
+		float t0 = (lo - o) / d;
+		float t1 = (hi - o) / d;
+		entry = std::min(t0, t1);
+		exit = std::max(t0, t1);
+		return true;
+	}
+}
+
+
+std::unique_ptr<Broadphase> Broadphase::create(const std::string& kind, float param) {
+	if (kind == "grid")
+		return std::make_unique<SpatialHash>(param);
+	if (kind == "tree")
+		return std::make_unique<AabbTree>(param);
+	throw std::runtime_error("Unknown broadphase - " + kind);
+}
+
+
+bool Broadphase::touchesSegment(const sf::FloatRect& box, sf::Vector2f origin, sf::Vector2f delta) {
+	float entryX, exitX, entryY, exitY;
+	if (!slab(origin.x, delta.x, box.left, box.left + box.width, entryX, exitX)
+		|| !slab(origin.y, delta.y, box.top, box.top + box.height, entryY, exitY))
+		return false;
+
+	float entry = std::max({ entryX, entryY, 0.f });
+	float exit = std::min({ exitX, exitY, 1.f });
+	return entry <= exit;
+}
+
+
+bool Broadphase::intersectRay(const sf::FloatRect& box, sf::Vector2f origin, sf::Vector2f delta, RayHit& hit) {
+	float entryX, exitX, entryY, exitY;
+	if (!slab(origin.x, delta.x, box.left, box.left + box.width, entryX, exitX)
+		|| !slab(origin.y, delta.y, box.top, box.top + box.height, entryY, exitY))
+		return false;
+
+	float entry = std::max(entryX, entryY);
+	float exit = std::min(exitX, exitY);
+	if (entry > exit || entry < 0.f || entry > 1.f)
+		return false;
+
+	hit.time = entry;
+	if (entryX > entryY)
+		hit.normal = sf::Vector2f(delta.x > 0.f ? -1.f : 1.f, 0.f);
+	else
+		hit.normal = sf::Vector2f(0.f, delta.y > 0.f ? -1.f : 1.f);
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EntityHandle.h"
+#include "CollisionFilter.h"
+
+
+// Common interface of the collision broadphases: SpatialHash for scenes of
+// evenly spread, similar sized colliders, AabbTree for a few fast movers
+// among many slow or static ones. All queries append to caller buffers,
+// skip entries the query's CollisionFilter doesn't accept, and test the
+// entities' exact AABBs.
+class Broadphase
+{
+public:
+	using Pair = std::pair<EntityHandle, EntityHandle>;
+
+	struct RayHit {
+		EntityHandle    handle;             // null for level geometry
+		float           time{ 1.f };        // fraction of the ray's delta
+		sf::Vector2f    normal{ 0.f, 0.f }; // face that was entered
+	};
+
+	virtual ~Broadphase() = default;
+
+	// "grid" (param = cell size) or "tree" (param = fat margin)
+	static std::unique_ptr<Broadphase> create(const std::string& kind, float param);
+
+	// inserts h, or moves it if it is already present
+	virtual void    update(EntityHandle h, const sf::FloatRect& bounds, const CollisionFilter& filter = {}) = 0;
+	virtual void    remove(EntityHandle h) = 0;
+	virtual bool    contains(EntityHandle h) const = 0;
+	// exact AABB of an entity that is present
+	virtual sf::FloatRect getBounds(EntityHandle h) const = 0;
+	virtual void    clear() = 0;
+	virtual size_t  size() const = 0;
+
+	// every entity whose AABB intersects bounds, each one once
+	virtual void    query(const sf::FloatRect& bounds, std::vector<EntityHandle>& out,
+		const CollisionFilter& filter = {}) = 0;
+	// every entity whose AABB contains p
+	virtual void    queryPoint(sf::Vector2f p, std::vector<EntityHandle>& out,
+		const CollisionFilter& filter = {}) = 0;
+	// every entity the segment origin -> origin + delta enters, unordered;
+	// entities containing origin are skipped
+	virtual void    queryRay(sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out,
+		const CollisionFilter& filter = {}) = 0;
+	// every intersecting pair whose filters accept each other, each one once
+	virtual void    queryPairs(std::vector<Pair>& out) = 0;
+
+protected:
+	// inclusive, for pruning cells and nodes; true if origin is inside box
+	static bool     touchesSegment(const sf::FloatRect& box, sf::Vector2f origin, sf::Vector2f delta);
+	static bool     intersectRay(const sf::FloatRect& box, sf::Vector2f origin, sf::Vector2f delta, RayHit& hit);
+};
@@ -0,0 +1,91 @@
+#include "CharacterController.h"
+#include "StaticBvh.h"
+#include <cmath>
+#include <limits>
+
+
+CharacterController::CharacterController(const StaticBvh& world)
+	: m_world(world) {}
+
+
+void CharacterController::step(CTransform& tfm, const CBoundingBox& box, CCharacterController& cc,
+	std::uint32_t mask, sf::Time dt) {
+	float t = dt.asSeconds();
+	auto& vel = tfm.vel;
+
+	// moving up means jumping off whatever we stood on
+	if (vel.y < 0.f)
+		cc.ground = CCharacterController::NoGround;
+	if (cc.isGrounded())
+		vel.y = 0.f;
+	else
+		vel.y += cc.gravity * t;
+
+	sf::FloatRect body(tfm.pos - box.halfSize, box.size);
+	sf::Vector2f delta = vel * t;
+	bool landed = false;
+	for (int i = 0; i < MaxSlides && (delta.x != 0.f || delta.y != 0.f); ++i) {
+		Physics::SweepHit hit;
+		if (!m_world.sweep(body, delta, hit, mask)) {
+			body.left += delta.x;
+			body.top += delta.y;
+			break;
+		}
+
+		// move up to the contact, then slide along it with what is left
+		body.left += delta.x * hit.time;
+		body.top += delta.y * hit.time;
+		delta *= 1.f - hit.time;
+		if (hit.normal.x != 0.f) {
+			delta.x = 0.f;
+			vel.x = 0.f;
+		}
+		else {
+			delta.y = 0.f;
+			vel.y = 0.f;
+			landed = landed || hit.normal.y < 0.f;
+		}
+	}
+	tfm.pos = sf::Vector2f(body.left, body.top) + box.halfSize;
+
+	if (cc.isGrounded() && cc.ground < m_world.size()) {
+		auto& support = m_world.getColliders()[cc.ground].bounds;
+		if (body.left < support.left + support.width && body.left + body.width > support.left) {
+			tfm.pos.y = support.top - box.halfSize.y;
+			return;
+		}
+		// walked off the edge, there may be another support right next to it
+		findGround(tfm, box, cc, mask);
+		return;
+	}
+
+	if (landed)
+		findGround(tfm, box, cc, mask);
+}
+
+
+bool CharacterController::findGround(CTransform& tfm, const CBoundingBox& box, CCharacterController& cc,
+	std::uint32_t mask) {
+	sf::FloatRect body(tfm.pos - box.halfSize, box.size);
+	float feet = body.top + body.height;
+
+	m_found.clear();
+	m_world.query(sf::FloatRect(body.left, feet - Skin, body.width, 2.f * Skin), m_found, mask);
+
+	cc.ground = CCharacterController::NoGround;
+	float best = std::numeric_limits<float>::infinity();
+	auto& colliders = m_world.getColliders();
+	for (auto i : m_found) {
+		float top = colliders[i].bounds.top;
+		if (std::abs(top - feet) <= Skin && top < best) {
+			best = top;
+			cc.ground = i;
+		}
+	}
+
+	if (!cc.isGrounded())
+		return false;
+	tfm.pos.y = best - box.halfSize.y;
+	tfm.vel.y = 0.f;
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SFML/System/Time.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Components.h"
+
+class StaticBvh;
+
+
+// Kinematic movement for CCharacterController entities: integrates gravity
+// and velocity, then moves and slides along the level's static colliders.
+// The collider stood on is cached in the component; while grounded the
+// body is kept on it without any query until it walks off its edge or
+// jumps, and only then is the world probed for a new support.
+class CharacterController
+{
+private:
+	static constexpr int    MaxSlides = 3;
+	static constexpr float  Skin = 1.f;     // how far a support may be from the feet
+
+	const StaticBvh&            m_world;
+	std::vector<std::uint32_t>  m_found;
+
+public:
+	explicit CharacterController(const StaticBvh& world);
+
+	void            step(CTransform& tfm, const CBoundingBox& box, CCharacterController& cc,
+		std::uint32_t mask, sf::Time dt);
+
+	// looks for a support right under the feet, snaps onto it and caches it
+	bool            findGround(CTransform& tfm, const CBoundingBox& box, CCharacterController& cc,
+		std::uint32_t mask);
+};
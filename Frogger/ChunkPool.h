@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+
+// Storage for T in fixed-size chunks. Elements never move, and memory is only
+// returned when the pool itself is destroyed, all chunks at once. Callers
+// construct objects in the storage handed out by allocate(). T must be
+// trivially destructible so tearing the pool down doesn't touch each element.
+template<typename T, size_t ChunkSize = 256>
+class ChunkPool
+{
+private:
+	struct alignas(T) Chunk {
+		std::byte storage[sizeof(T) * ChunkSize];
+	};
+
+	std::vector<std::unique_ptr<Chunk>>     m_chunks;
+	size_t                                  m_size{ 0 };
+
+	std::byte* address(size_t i) const {
+		return m_chunks[i / ChunkSize]->storage + (i % ChunkSize) * sizeof(T);
+	}
+
+public:
+	ChunkPool() = default;
+	ChunkPool(const ChunkPool&) = delete;
+	ChunkPool& operator=(const ChunkPool&) = delete;
+
+	~ChunkPool() {
+		static_assert(std::is_trivially_destructible_v<T>, "ChunkPool frees its chunks without running destructors");
+	}
+
+	// raw storage for element size(), construct a T in it before using it
+	void* allocate() {
+		if (m_size == capacity())
+			m_chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+		return address(m_size++);
+	}
+
+	void reserve(size_t n) {
+		while (capacity() < n)
+			m_chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+	}
+
+	T& operator[](size_t i) { return *std::launder(reinterpret_cast<T*>(address(i))); }
+	const T& operator[](size_t i) const { return *std::launder(reinterpret_cast<const T*>(address(i))); }
+
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_chunks.size() * ChunkSize; }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+
+// Which collision layer something is on (category) and which layers it
+// collides with (mask). Two things only interact if each one's mask has
+// the other's category; checked before any geometry test.
+struct CollisionFilter
+{
+	enum layers : std::uint32_t {
+		DEFAULT = 1 << 0,
+		PLAYER  = 1 << 1,
+		GROUND  = 1 << 2,
+		TRIGGER = 1 << 3,
+		ALL     = 0xFFFFFFFF
+	};
+
+	std::uint32_t   category{ DEFAULT };
+	std::uint32_t   mask{ ALL };
+
+	bool accepts(const CollisionFilter& other) const {
+		return (mask & other.category) != 0 && (other.mask & category) != 0;
+	}
+};
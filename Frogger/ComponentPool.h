@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+
+// Sparse set holding every component of one type in a contiguous array.
+// The sparse array maps an entity slot to its position in the dense array,
+// so lookups are O(1) and systems can stream through the dense array.
+template<typename T>
+class ComponentPool
+{
+public:
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+private:
+	std::vector<T>                  m_dense;
+	std::vector<std::uint32_t>      m_owners;
+	std::vector<std::uint32_t>      m_sparse;
+
+public:
+	bool contains(std::uint32_t slot) const {
+		return slot < m_sparse.size() && m_sparse[slot] != npos;
+	}
+
+	T& get(std::uint32_t slot) {
+		assert(contains(slot));
+		return m_dense[m_sparse[slot]];
+	}
+
+	const T& get(std::uint32_t slot) const {
+		assert(contains(slot));
+		return m_dense[m_sparse[slot]];
+	}
+
+	template<typename... TArgs>
+	T& emplace(std::uint32_t slot, TArgs&&... mArgs) {
+		if (contains(slot)) {
+			auto& component = m_dense[m_sparse[slot]];
+			component = T(std::forward<TArgs>(mArgs)...);
+			return component;
+		}
+
+		if (slot >= m_sparse.size())
+			m_sparse.resize(slot + 1, npos);
+
+		m_sparse[slot] = static_cast<std::uint32_t>(m_dense.size());
+		m_owners.push_back(slot);
+		return m_dense.emplace_back(std::forward<TArgs>(mArgs)...);
+	}
+
+	// swap-and-pop so the dense array stays packed
+	bool remove(std::uint32_t slot) {
+		if (!contains(slot))
+			return false;
+
+		auto idx = m_sparse[slot];
+		auto last = static_cast<std::uint32_t>(m_dense.size() - 1);
+		if (idx != last) {
+			m_dense[idx] = std::move(m_dense[last]);
+			m_owners[idx] = m_owners[last];
+			m_sparse[m_owners[idx]] = idx;
+		}
+		m_dense.pop_back();
+		m_owners.pop_back();
+		m_sparse[slot] = npos;
+		return true;
+	}
+
+	void reserve(size_t n) {
+		m_dense.reserve(n);
+		m_owners.reserve(n);
+		m_sparse.reserve(n);
+	}
+
+	void clear() {
+		m_dense.clear();
+		m_owners.clear();
+		m_sparse.clear();
+	}
+
+	size_t                              size() const { return m_dense.size(); }
+	bool                                empty() const { return m_dense.empty(); }
+	std::uint32_t                       owner(size_t i) const { return m_owners[i]; }
+	T&                                  component(size_t i) { return m_dense[i]; }
+	const T&                            component(size_t i) const { return m_dense[i]; }
+	const std::vector<std::uint32_t>&   owners() const { return m_owners; }
+
+	auto begin() { return m_dense.begin(); }
+	auto end() { return m_dense.end(); }
+	auto begin() const { return m_dense.begin(); }
+	auto end() const { return m_dense.end(); }
+};
@@ -10,12 +10,14 @@
 #include <SFML/Graphics.hpp>
 #include "Utilities.h"
 #include "Animation.h"
+#include "StateMachine.h"
+#include "CollisionFilter.h"
 #include <bitset>
+#include <tuple>
 
 
 struct Component
 {
-    bool		has{ false };
     Component() = default;
 };
 
@@ -56,9 +58,10 @@ struct CTransform : public Component
 
     float           angVel{ 0 };
     float	        angle{ 0.f };
+    std::uint16_t   stillFrames{ 0 };   // updates in a row without velocity, see CSleeping
 
     CTransform() = default;
-    CTransform(const sf::Vector2f& p) : pos(p)  {}
+    CTransform(const sf::Vector2f& p) : pos(p), prevPos(p)  {}
     CTransform(const sf::Vector2f& p, const sf::Vector2f& v)
             : pos(p), prevPos(p),  vel(v){}
 
@@ -76,12 +79,49 @@ struct CBoundingBox : public Component
     {}
 };
 
+struct CCollisionFilter : public Component
+{
+    CollisionFilter filter;
+
+    CCollisionFilter() = default;
+    CCollisionFilter(std::uint32_t category, std::uint32_t mask) : filter{ category, mask } {}
+};
+
+// moved by CharacterController instead of the movement system
+struct CCharacterController : public Component
+{
+    static constexpr std::uint32_t NoGround = 0xFFFFFFFF;
+
+    float           gravity{ 0.f };
+    std::uint32_t   ground{ NoGround };     // static collider stood on, kept between frames
+
+    CCharacterController() = default;
+    CCharacterController(float g) : gravity(g) {}
+
+    bool isGrounded() const { return ground != NoGround; }
+};
+
+// at rest: movement and the broadphase sync skip the entity until
+// Physics::wake removes this. Physics::integrate adds it once CTransform::stillFrames runs out.
+struct CSleeping : public Component
+{
+    CSleeping() = default;
+};
+
+// sensor volume, see TriggerSystem; never blocks anything
+struct CTrigger : public Component
+{
+    CTrigger() = default;
+};
+
 struct CState : public Component {
-    std::string state{"none"};
+    const StateMachine* machine{ nullptr };
+    StateId             state{ StateMachine::None };
 
     CState() = default;
-    CState(const std::string& s) : state(s){}
+    CState(const StateMachine& m, StateId s) : machine(&m), state(s) {}
 
+    bool is(StateId s) const { return state == s; }
 };
 
 
@@ -100,4 +140,29 @@ struct CInput : public Component
 };
 
 
+using ComponentTuple = std::tuple<CSprite, CAnimation, CState, CTransform, CBoundingBox, CInput, CCollisionFilter, CTrigger,
+        CCharacterController, CSleeping>;
+
+
+// one bit per ComponentTuple entry, the bit index is the tuple index
+using ComponentSignature = std::bitset<std::tuple_size_v<ComponentTuple>>;
+
+template<typename T, typename Tuple> struct ComponentIndex;
+
+template<typename T, typename... Ts>
+struct ComponentIndex<T, std::tuple<T, Ts...>> : std::integral_constant<size_t, 0> {};
+
+template<typename T, typename U, typename... Ts>
+struct ComponentIndex<T, std::tuple<U, Ts...>>
+        : std::integral_constant<size_t, 1 + ComponentIndex<T, std::tuple<Ts...>>::value> {};
+
+template<typename T>
+constexpr size_t componentIndex = ComponentIndex<T, ComponentTuple>::value;
+
+template<typename... Ts>
+constexpr ComponentSignature componentSignature() {
+    return ComponentSignature(((1ull << componentIndex<Ts>) | ... | 0ull));
+}
+
+
 #endif //BREAKOUT_COMPONENTS_H
@@ -0,0 +1,60 @@
+#include "ContactCache.h"
+#include "Entity.h"
+
+
+ContactCache::ContactCache(float threshold)
+	: m_threshold(threshold) {}
+
+
+bool ContactCache::moved(const Entity& e) {
+	auto h = e.getHandle();
+	auto& pos = e.getComponent<CTransform>().pos;
+	if (h.index >= m_bodies.size())
+		m_bodies.resize(h.index + 1);
+
+	auto& body = m_bodies[h.index];
+	auto d = pos - body.pos;
+	if (body.known && body.generation == h.generation && d.x * d.x + d.y * d.y <= m_threshold * m_threshold)
+		return false;
+
+	body.generation = h.generation;
+	body.known = true;
+	body.pos = pos;
+	return true;
+}
+
+
+const Contact& ContactCache::update(const Entity& a, const Entity& b, sf::Vector2f overlap) {
+	auto& posA = a.getComponent<CTransform>().pos;
+	auto& posB = b.getComponent<CTransform>().pos;
+
+	auto& contact = m_contacts[Key{ a.getHandle(), b.getHandle() }];
+	contact.overlap = overlap;
+	if (overlap.x < overlap.y)
+		contact.normal = sf::Vector2f(posA.x < posB.x ? -1.f : 1.f, 0.f);
+	else
+		contact.normal = sf::Vector2f(0.f, posA.y < posB.y ? -1.f : 1.f);
+	return contact;
+}
+
+
+const Contact* ContactCache::find(EntityHandle a, EntityHandle b) const {
+	auto it = m_contacts.find(Key{ a, b });
+	return it == m_contacts.end() ? nullptr : &it->second;
+}
+
+
+void ContactCache::remove(EntityHandle a, EntityHandle b) {
+	m_contacts.erase(Key{ a, b });
+}
+
+
+void ContactCache::clear() {
+	m_contacts.clear();
+	m_bodies.clear();
+}
+
+
+size_t ContactCache::size() const {
+	return m_contacts.size();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "EntityHandle.h"
+
+class Entity;
+
+
+struct Contact
+{
+	sf::Vector2f    overlap;        // per axis, as Physics::getOverlap
+	sf::Vector2f    normal;         // axis of least penetration, pointing from b towards a
+};
+
+
+// Contacts between entity pairs kept from frame to frame, and where each
+// body was when its contacts were last worked out. moved() tells the
+// caller which bodies got further than the threshold from there; pairs of
+// bodies that didn't can keep their contact as it is. Keys are ordered
+// pairs: (a, b) and (b, a) are different contacts.
+class ContactCache
+{
+public:
+	using Key = std::pair<EntityHandle, EntityHandle>;
+
+private:
+	struct KeyHash {
+		size_t operator()(const Key& k) const noexcept {
+			auto h = std::hash<EntityHandle>{}(k.first);
+			return h ^ (std::hash<EntityHandle>{}(k.second) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+		}
+	};
+
+	struct Body {
+		std::uint32_t   generation{ 0 };
+		bool            known{ false };
+		sf::Vector2f    pos;
+	};
+
+	std::unordered_map<Key, Contact, KeyHash>   m_contacts;
+	std::vector<Body>                           m_bodies;       // by slot
+	float                                       m_threshold;
+
+public:
+	explicit ContactCache(float threshold = 0.5f);
+
+	// true, and e's position is remembered, if e is new to the cache or
+	// further than the threshold from where it was last remembered
+	bool            moved(const Entity& e);
+
+	// stores the overlap from Physics::getOverlaps; a and b need a CTransform
+	const Contact&  update(const Entity& a, const Entity& b, sf::Vector2f overlap);
+	const Contact*  find(EntityHandle a, EntityHandle b) const;
+	void            remove(EntityHandle a, EntityHandle b);
+	void            clear();
+	size_t          size() const;
+};
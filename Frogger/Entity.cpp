@@ -4,23 +4,49 @@
 
 #include "Entity.h"
 
-Entity::Entity(size_t id, const std::string &tag)
-        : m_tag(tag), m_id(id) {
+Entity::Entity(EntityManager* manager, std::uint32_t slot)
+        : m_manager(manager), m_slot(slot) {
 
 }
 
+void Entity::reset(size_t id, TagId tag) {
+    m_id = id;
+    m_tag = tag;
+    m_active = true;
+}
+
 void Entity::destroy() {
+    if (!m_active)
+        return;
+
     m_active = false;
+    m_manager->queueDestroy(*this);
 }
 
 const size_t &Entity::getId() const {
     return m_id;
 }
 
-const std::string &Entity::getTag() const {
+TagId Entity::getTag() const {
     return m_tag;
 }
 
+const std::string &Entity::getTagName() const {
+    return EntityManager::tagName(m_tag);
+}
+
 bool Entity::isActive() const {
     return m_active;
 }
+
+std::uint32_t Entity::getSlot() const {
+    return m_slot;
+}
+
+EntityHandle Entity::getHandle() const {
+    return EntityHandle{ m_slot, m_generation };
+}
+
+const ComponentSignature &Entity::getSignature() const {
+    return m_signature;
+}
@@ -8,61 +8,102 @@
 
 #include <tuple>
 #include <string>
+#include <cstdint>
 
 #include "Components.h"
+#include "EntityHandle.h"
 
 class EntityManager;
 
-using ComponentTuple = std::tuple<CSprite, CAnimation, CState, CTransform, CBoundingBox, CInput>;
-
+// Components live in the EntityManager's per-type pools; the entity only
+// knows which slot it occupies in them. Entities are owned by the manager's
+// slot map, reference them through an EntityHandle.
 class Entity {
 private:
 	friend class EntityManager;
-	Entity(size_t id, const std::string& tag);
+	Entity(EntityManager* manager, std::uint32_t slot);
+
+	void                    reset(size_t id, TagId tag);
 
-	const size_t            m_id{ 0 };
-	const std::string       m_tag{ "Default" };
+	size_t                  m_id{ 0 };
+	TagId                   m_tag{ 0 };
 	bool                    m_active{ true };
-	ComponentTuple          m_components;
+	EntityManager*          m_manager{ nullptr };
+	std::uint32_t           m_slot{ 0 };
+	std::uint32_t           m_generation{ 0 };
+	ComponentSignature      m_signature;
+	bool                    m_committed{ false };
+	std::uint32_t           m_entityIndex{ 0 };     // position in m_entities
+	std::uint32_t           m_bucketIndex{ 0 };     // position in the tag bucket
 
 public:
+	Entity(const Entity&) = delete;
+	Entity& operator=(const Entity&) = delete;
 
 	void                    destroy();
 	const size_t& getId() const;
-	const std::string& getTag() const;
+	TagId                   getTag() const;
+	const std::string&      getTagName() const;
 	bool                    isActive() const;
+	std::uint32_t           getSlot() const;
+	EntityHandle            getHandle() const;
+	const ComponentSignature& getSignature() const;
 
 
 	template<typename T>
-	inline bool hasComponent() const {
-		return getComponent<T>().has;
-	}
+	bool hasComponent() const;
 
 	template<typename T, typename... TArgs>
-	inline T& addComponent(TArgs &&... mArgs) {
-		auto& component = getComponent<T>();
-		component = T(std::forward<TArgs>(mArgs)...);
-		component.has = true;
-		return component;
-	}
+	T& addComponent(TArgs &&... mArgs);
 
 	template<typename T>
-	inline bool removeComponent() {
-		return getComponent<T>().has = false;
-	}
+	bool removeComponent();
 
 	template<typename T>
-	inline T& getComponent() {
-		return std::get<T>(m_components);
-	}
-
+	T& getComponent();
 
 	template<typename T>
-	inline const T& getComponent() const {
-		return std::get<T>(m_components);
-	}
+	const T& getComponent() const;
 };
 
 
+#include "EntityManager.h"
+
+
+template<typename T>
+inline bool Entity::hasComponent() const {
+	return m_signature.test(componentIndex<T>);
+}
+
+template<typename T, typename... TArgs>
+inline T& Entity::addComponent(TArgs &&... mArgs) {
+	auto& component = m_manager->getComponents<T>().emplace(m_slot, std::forward<TArgs>(mArgs)...);
+	if (!m_signature.test(componentIndex<T>)) {
+		m_signature.set(componentIndex<T>);
+		m_manager->onSignatureChanged(*this);
+	}
+	return component;
+}
+
+template<typename T>
+inline bool Entity::removeComponent() {
+	if (!m_manager->getComponents<T>().remove(m_slot))
+		return false;
+
+	m_signature.reset(componentIndex<T>);
+	m_manager->onSignatureChanged(*this);
+	return true;
+}
+
+template<typename T>
+inline T& Entity::getComponent() {
+	return m_manager->getComponents<T>().get(m_slot);
+}
+
+template<typename T>
+inline const T& Entity::getComponent() const {
+	return std::as_const(*m_manager).getComponents<T>().get(m_slot);
+}
+
 
 #endif //BREAKOUT_ENTITY_H
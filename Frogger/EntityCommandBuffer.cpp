@@ -0,0 +1,61 @@
+#include "EntityCommandBuffer.h"
+
+
+bool EntityCommandBuffer::before(const Command& a, const Command& b) {
+	if (a.spawn != b.spawn)
+		return b.spawn;
+	if (a.sortKey != b.sortKey)
+		return a.sortKey < b.sortKey;
+	if (a.work.job != b.work.job)
+		return a.work.job < b.work.job;
+	if (a.work.chunk != b.work.chunk)
+		return a.work.chunk < b.work.chunk;
+	return a.sequence < b.sequence;
+}
+
+
+void EntityCommandBuffer::record(std::uint64_t sortKey, bool spawn, TagId tag, EntityHandle target, EntityFn apply) {
+	auto& command = m_commands.emplace_back();
+	command.sortKey = sortKey;
+	command.work = JobSystem::currentWork();
+	command.sequence = static_cast<std::uint32_t>(m_commands.size() - 1);
+	command.spawn = spawn;
+	command.tag = tag;
+	command.target = target;
+	command.apply = std::move(apply);
+}
+
+
+void EntityCommandBuffer::spawn(TagId tag, EntityFn init, std::uint64_t sortKey) {
+	record(sortKey, true, tag, EntityHandle{}, std::move(init));
+}
+
+
+void EntityCommandBuffer::destroy(EntityHandle target) {
+	destroy(target, target.index);
+}
+
+
+void EntityCommandBuffer::destroy(EntityHandle target, std::uint64_t sortKey) {
+	record(sortKey, false, 0, target, [](Entity& e) { e.destroy(); });
+}
+
+
+void EntityCommandBuffer::modify(EntityHandle target, EntityFn fn) {
+	record(target.index, false, 0, target, std::move(fn));
+}
+
+
+std::vector<EntityCommandBuffer::Command>& EntityCommandBuffer::getCommands() {
+	return m_commands;
+}
+
+
+bool EntityCommandBuffer::empty() const {
+	return m_commands.empty();
+}
+
+
+void EntityCommandBuffer::clear() {
+	m_commands.clear();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Entity.h"
+#include "JobSystem.h"
+
+
+// Records structural changes (spawn, destroy, add/remove component) so they
+// can be made from worker threads. Each thread records into its own buffer,
+// see EntityManager::commands(); EntityManager::update() applies all of them
+// on the main thread.
+//
+// Commands on existing entities are applied first, then spawns. Within
+// each group they are ordered by sort key, then by the JobSystem::WorkId
+// they were recorded under, then by recording order, so the result doesn't
+// depend on which worker recorded what. The key defaults to the target's
+// slot; spawns should pass something stable such as the loop index.
+class EntityCommandBuffer
+{
+public:
+	using EntityFn = std::function<void(Entity&)>;
+
+	struct Command {
+		std::uint64_t       sortKey{ 0 };
+		JobSystem::WorkId   work;
+		std::uint32_t       sequence{ 0 };
+		bool                spawn{ false };
+		TagId               tag{ 0 };
+		EntityHandle        target;
+		EntityFn            apply;
+	};
+
+	// playback order, see above
+	static bool before(const Command& a, const Command& b);
+
+private:
+	std::vector<Command>    m_commands;
+
+	void record(std::uint64_t sortKey, bool spawn, TagId tag, EntityHandle target, EntityFn apply);
+
+public:
+	void spawn(TagId tag, EntityFn init = {}, std::uint64_t sortKey = 0);
+	void destroy(EntityHandle target);
+	void destroy(EntityHandle target, std::uint64_t sortKey);
+	// runs fn on target at playback, for changes that depend on its state by then
+	void modify(EntityHandle target, EntityFn fn);
+
+	template<typename T>
+	void addComponent(EntityHandle target, T component) {
+		addComponent(target, std::move(component), target.index);
+	}
+
+	template<typename T>
+	void addComponent(EntityHandle target, T component, std::uint64_t sortKey) {
+		record(sortKey, false, 0, target,
+			[c = std::move(component)](Entity& e) mutable { e.addComponent<T>(std::move(c)); });
+	}
+
+	template<typename T>
+	void removeComponent(EntityHandle target, std::uint64_t sortKey) {
+		record(sortKey, false, 0, target, [](Entity& e) { e.removeComponent<T>(); });
+	}
+
+	template<typename T>
+	void removeComponent(EntityHandle target) {
+		removeComponent<T>(target, target.index);
+	}
+
+	std::vector<Command>&   getCommands();
+	bool                    empty() const;
+	void                    clear();
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <functional>
+
+
+// Interned entity tag, see EntityManager::internTag
+using TagId = std::uint16_t;
+
+
+// Weak reference to an entity: the slot it lives in plus the generation of
+// that slot when the handle was made. The EntityManager bumps the generation
+// whenever a slot is released, so handles to dead entities stop resolving.
+struct EntityHandle
+{
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+	std::uint32_t   index{ npos };
+	std::uint32_t   generation{ 0 };
+
+	bool isNull() const { return index == npos; }
+	explicit operator bool() const { return !isNull(); }
+
+	friend bool operator==(const EntityHandle& a, const EntityHandle& b) {
+		return a.index == b.index && a.generation == b.generation;
+	}
+	friend bool operator!=(const EntityHandle& a, const EntityHandle& b) {
+		return !(a == b);
+	}
+	// slot first, so sorted handles walk the pools in order
+	friend bool operator<(const EntityHandle& a, const EntityHandle& b) {
+		return a.index != b.index ? a.index < b.index : a.generation < b.generation;
+	}
+};
+
+
+template<>
+struct std::hash<EntityHandle>
+{
+	size_t operator()(const EntityHandle& h) const noexcept {
+		return std::hash<std::uint64_t>{}((std::uint64_t(h.generation) << 32) | h.index);
+	}
+};
@@ -4,50 +4,375 @@
 
 #include "EntityManager.h"
 #include "Entity.h"
+#include "EntityCommandBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
 
-EntityManager::EntityManager() : m_totalEntities(0) {}
+namespace {
+	struct TagTable {
+		std::unordered_map<std::string, TagId>  ids;
+		std::vector<std::string>                names;
+	};
 
+	TagTable& tagTable() {
+		static TagTable table;
+		return table;
+	}
+
+	// managers are told apart by serial, never by address, so a thread's
+	// cached buffer can't outlive its manager and be picked up by a new one
+	std::atomic<std::uint64_t> nextManagerSerial{ 1 };
+
+	struct CachedBuffer {
+		std::uint64_t           manager;
+		EntityCommandBuffer*    buffer;
+	};
+
+	// A thread's buffers, one per manager it has recorded into. Every
+	// thread's cache is registered so a dying manager can take its entry
+	// out of all of them; the lock is only ever contended then.
+	struct BufferCache {
+		std::mutex                  mutex;
+		std::vector<CachedBuffer>   entries;
+
+		BufferCache();
+		~BufferCache();
+	};
+
+	struct CacheRegistry {
+		std::mutex                  mutex;
+		std::vector<BufferCache*>   caches;
+	};
+
+	// never destroyed, managers with static storage may outlive it otherwise
+	CacheRegistry& cacheRegistry() {
+		static auto registry = new CacheRegistry;
+		return *registry;
+	}
+
+	BufferCache::BufferCache() {
+		auto& registry = cacheRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.caches.push_back(this);
+	}
+
+	BufferCache::~BufferCache() {
+		auto& registry = cacheRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.caches.erase(std::find(registry.caches.begin(), registry.caches.end(), this));
+	}
+
+	thread_local BufferCache t_commandBuffers;
+}
 
-std::shared_ptr<Entity> EntityManager::addEntity(const std::string& tag) {
-	// create a new Entity object
-	auto e = std::shared_ptr<Entity>(new Entity(m_totalEntities++, tag));
+EntityManager::EntityManager()
+	: m_totalEntities(0)
+	, m_serial(nextManagerSerial.fetch_add(1)) {}
+
+EntityManager::~EntityManager() {
+	if (m_commandBuffers.empty())
+		return;
+
+	auto& registry = cacheRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (auto cache : registry.caches) {
+		std::lock_guard<std::mutex> cacheLock(cache->mutex);
+		auto& entries = cache->entries;
+		entries.erase(std::remove_if(entries.begin(), entries.end(),
+			[this](const CachedBuffer& cached) { return cached.manager == m_serial; }), entries.end());
+	}
+}
+
+
+void EntityManager::reserve(size_t n) {
+	m_slots.reserve(n);
+	m_freeSlots.reserve(n);
+	m_entities.reserve(n);
+	m_EntitiesToAdd.reserve(n);
+	m_EntitiesToDestroy.reserve(n);
+	m_destroyed.reserve(n);
+	std::apply([n](auto&... pool) { (pool.reserve(n), ...); }, m_pools);
+
+	m_reserved = std::max(m_reserved, n);
+	for (auto& bucket : m_entityBuckets)
+		bucket.reserve(m_reserved);
+	for (auto& list : m_matchLists)
+		list->reserve(m_reserved);
+}
+
+
+TagId EntityManager::internTag(const std::string& name) {
+	auto& table = tagTable();
+	auto it = table.ids.find(name);
+	if (it != table.ids.end())
+		return it->second;
+
+	auto id = static_cast<TagId>(table.names.size());
+	table.ids.emplace(name, id);
+	table.names.push_back(name);
+	return id;
+}
+
+
+const std::string& EntityManager::tagName(TagId tag) {
+	return tagTable().names.at(tag);
+}
+
+
+Entity& EntityManager::addEntity(const std::string& tag) {
+	return addEntity(internTag(tag));
+}
+
+
+Entity& EntityManager::addEntity(TagId tag) {
+	// reuse a released slot if there is one
+	Entity* e;
+	if (!m_freeSlots.empty()) {
+		e = &m_slots[m_freeSlots.back()];
+		m_freeSlots.pop_back();
+	}
+	else {
+		auto slot = static_cast<std::uint32_t>(m_slots.size());
+		e = new (m_slots.allocate()) Entity(this, slot);
+	}
+	e->reset(m_totalEntities++, tag);
 
 	// store it in entities vector
 	m_EntitiesToAdd.push_back(e);
-	// return shared pointer to it
-	return e;
+	return *e;
+}
+
+
+EntityVec& EntityManager::getEntities(TagId tag) {
+	while (tag >= m_entityBuckets.size())
+		m_entityBuckets.emplace_back().reserve(m_reserved);
+	return m_entityBuckets[tag];
 }
 
 
 EntityVec& EntityManager::getEntities(const std::string& tag) {
-	return m_entityMap[tag];
+	return getEntities(internTag(tag));
+}
+
+
+Entity* EntityManager::get(EntityHandle h) {
+	return isValid(h) ? &m_slots[h.index] : nullptr;
+}
+
+
+const Entity* EntityManager::get(EntityHandle h) const {
+	return isValid(h) ? &m_slots[h.index] : nullptr;
+}
+
+
+bool EntityManager::isValid(EntityHandle h) const {
+	return h.index < m_slots.size() && m_slots[h.index].m_generation == h.generation;
+}
+
+
+EntityCommandBuffer& EntityManager::commands() {
+	std::lock_guard<std::mutex> cacheLock(t_commandBuffers.mutex);
+	for (auto& cached : t_commandBuffers.entries) {
+		if (cached.manager == m_serial)
+			return *cached.buffer;
+	}
+
+	EntityCommandBuffer* buffer;
+	{
+		std::lock_guard<std::mutex> lock(m_commandMutex);
+		buffer = m_commandBuffers.emplace_back(std::make_unique<EntityCommandBuffer>()).get();
+	}
+	t_commandBuffers.entries.push_back(CachedBuffer{ m_serial, buffer });
+	return *buffer;
+}
+
+
+void EntityManager::playbackCommands() {
+	std::vector<EntityCommandBuffer::Command*> merged;
+	for (auto& buffer : m_commandBuffers) {
+		for (auto& command : buffer->getCommands())
+			merged.push_back(&command);
+	}
+	if (merged.empty())
+		return;
+
+	// deterministic regardless of which thread recorded what
+	std::stable_sort(merged.begin(), merged.end(), [](auto a, auto b) {
+		return EntityCommandBuffer::before(*a, *b);
+	});
+
+	for (auto command : merged) {
+		if (command->spawn) {
+			auto& e = addEntity(command->tag);
+			if (command->apply)
+				command->apply(e);
+		}
+		else if (auto e = get(command->target)) {
+			command->apply(*e);
+		}
+	}
+
+	for (auto& buffer : m_commandBuffers)
+		buffer->clear();
 }
 
 
 void EntityManager::update() {
-	// Remove dead entities
-	removeDeadEntities(m_entities);
-	for (auto& [_, entityVec] : m_entityMap)
-		removeDeadEntities(entityVec);
+	m_destroyed.clear();
+	playbackCommands();
+
+	// Remove dead entities, only the ones destroyed since the last update are visited
+	for (auto e : m_EntitiesToDestroy)
+	{
+		// entities that died before being committed are released below
+		if (e->m_committed) {
+			m_destroyed.push_back(e->getHandle());
+			unlinkEntity(*e);
+			releaseEntity(*e);
+		}
+	}
+	m_EntitiesToDestroy.clear();
 
 
 	// add new entities
 	for (auto e : m_EntitiesToAdd)
 	{
-		m_entities.push_back(e);
-		m_entityMap[e->getTag()].push_back(e);
+		if (e->isActive())
+			commitEntity(*e);
+		else
+			releaseEntity(*e);
 	}
 	m_EntitiesToAdd.clear();
 }
 
 
+const std::vector<EntityHandle>& EntityManager::getDestroyed() const {
+	return m_destroyed;
+}
+
+
+void EntityManager::queueDestroy(Entity& e) {
+	m_EntitiesToDestroy.push_back(&e);
+}
+
+
+void EntityManager::commitEntity(Entity& e) {
+	auto& bucket = getEntities(e.getTag());
+	e.m_entityIndex = static_cast<std::uint32_t>(m_entities.size());
+	e.m_bucketIndex = static_cast<std::uint32_t>(bucket.size());
+	m_entities.push_back(&e);
+	bucket.push_back(&e);
+
+	e.m_committed = true;
+	onSignatureChanged(e);
+}
+
+
+void EntityManager::unlinkEntity(Entity& e) {
+	// swap-and-pop, fixing up the back-index of the entity moved into the hole
+	auto& last = m_entities.back();
+	last->m_entityIndex = e.m_entityIndex;
+	m_entities[e.m_entityIndex] = last;
+	m_entities.pop_back();
+
+	auto& bucket = m_entityBuckets[e.getTag()];
+	auto& lastInBucket = bucket.back();
+	lastInBucket->m_bucketIndex = e.m_bucketIndex;
+	bucket[e.m_bucketIndex] = lastInBucket;
+	bucket.pop_back();
+}
+
+
+Entity& EntityManager::entityAt(std::uint32_t slot) {
+	return m_slots[slot];
+}
+
+
+void EntityManager::onSignatureChanged(Entity& e) {
+	// entities join the views when update() commits them
+	if (!e.m_committed)
+		return;
+
+	for (auto& list : m_matchLists) {
+		bool matches = list->matches(e.m_signature);
+		if (matches != list->contains(e.getSlot())) {
+			if (matches)
+				list->add(e.getSlot());
+			else
+				list->remove(e.getSlot());
+		}
+	}
+}
+
+
+MatchList& EntityManager::getMatchList(const ComponentSignature& mask, const ComponentSignature& exclude) {
+	for (auto& list : m_matchLists) {
+		if (list->mask == mask && list->exclude == exclude)
+			return *list;
+	}
+
+	auto& list = m_matchLists.emplace_back(std::make_unique<MatchList>());
+	list->mask = mask;
+	list->exclude = exclude;
+	list->reserve(m_reserved);
+	for (auto e : m_entities) {
+		if (list->matches(e->m_signature))
+			list->add(e->getSlot());
+	}
+	return *list;
+}
+
+
 EntityVec& EntityManager::getEntities() {
 	return m_entities;
 }
 
 
-void EntityManager::removeDeadEntities(EntityVec& v) {
-	v.erase(std::remove_if(v.begin(), v.end(), [](auto e) {return!(e->isActive()); }), v.end());
+void EntityManager::releaseEntity(Entity& e) {
+	std::apply([slot = e.getSlot()](auto&... pool) { (pool.remove(slot), ...); }, m_pools);
+	for (auto& list : m_matchLists)
+		list->remove(e.getSlot());
+	e.m_signature.reset();
+	e.m_committed = false;
+
+	// outstanding handles to this slot stop resolving
+	++e.m_generation;
+	m_freeSlots.push_back(e.getSlot());
 }
 
 
+bool MatchList::matches(const ComponentSignature& signature) const {
+	return (signature & mask) == mask && (signature & exclude).none();
+}
+
+
+bool MatchList::contains(std::uint32_t slot) const {
+	return slot < positions.size() && positions[slot] != npos;
+}
+
+
+void MatchList::reserve(size_t n) {
+	slots.reserve(n);
+	positions.reserve(n);
+}
+
+
+void MatchList::add(std::uint32_t slot) {
+	if (slot >= positions.size())
+		positions.resize(slot + 1, npos);
+	positions[slot] = static_cast<std::uint32_t>(slots.size());
+	slots.push_back(slot);
+}
+
+
+void MatchList::remove(std::uint32_t slot) {
+	if (!contains(slot))
+		return;
+
+	auto idx = positions[slot];
+	slots[idx] = slots.back();
+	positions[slots[idx]] = idx;
+	slots.pop_back();
+	positions[slot] = npos;
+}
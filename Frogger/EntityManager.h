@@ -6,37 +6,206 @@
 #define BREAKOUT_ENTITYMANAGER_H
 
 
+#include <deque>
 #include <map>
 #include <vector>
 #include <string>
 #include <memory>
+#include <tuple>
+#include <cstdint>
+#include <type_traits>
+#include <limits>
+#include <mutex>
+
+#include "Components.h"
+#include "ComponentPool.h"
+#include "ChunkPool.h"
+#include "EntityHandle.h"
 
 //forward declare
 class Entity;
+class EntityCommandBuffer;
+
+using EntityVec = std::vector<Entity*>;
+
+template<typename Tuple> struct PoolTuple;
+template<typename... Ts> struct PoolTuple<std::tuple<Ts...>> {
+	using type = std::tuple<ComponentPool<Ts>...>;
+};
+using ComponentPools = PoolTuple<ComponentTuple>::type;
+
+
+// Cached list of the committed entities whose signature contains mask and
+// nothing in exclude. Kept up to date as components are added and removed.
+struct MatchList
+{
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+	ComponentSignature              mask;
+	ComponentSignature              exclude;
+	std::vector<std::uint32_t>      slots;
+	std::vector<std::uint32_t>      positions;      // slot -> index in slots
+
+	bool matches(const ComponentSignature& signature) const;
+	bool contains(std::uint32_t slot) const;
+	void add(std::uint32_t slot);
+	void remove(std::uint32_t slot);
+	void reserve(size_t n);
+};
 
-using sPtrEntt = std::shared_ptr<Entity>;
-using EntityVec = std::vector<std::shared_ptr<Entity>>;
-using EntityMap = std::map <std::string, EntityVec>;
+template<typename... Ts> class View;
 
+// components an EntityManager::view must not have
+template<typename... Ts> struct Without {};
 
 class EntityManager
 {
 private:
 	EntityVec	    m_entities;
-	EntityMap	    m_entityMap;
+	std::deque<EntityVec>   m_entityBuckets;     // indexed by TagId; a deque so growing keeps references
 	size_t		    m_totalEntities{ 0 };
 	EntityVec	    m_EntitiesToAdd;
+	EntityVec	    m_EntitiesToDestroy;
+	std::vector<EntityHandle>   m_destroyed;
+
+	// slot map: entities live in pooled chunks owned by the manager, never
+	// move once created, and dead slots are recycled. The chunks are freed
+	// in bulk with the owning Scene without visiting each entity; the
+	// component pools still run each component's destructor.
+	ChunkPool<Entity>                       m_slots;
+	std::vector<std::uint32_t>              m_freeSlots;
+	ComponentPools                          m_pools;
+	std::vector<std::unique_ptr<MatchList>> m_matchLists;
+	size_t                                  m_reserved{ 0 };    // see reserve()
+
+	// one command buffer per thread that has recorded into this manager
+	const std::uint64_t                                 m_serial;
+	std::mutex                                          m_commandMutex;
+	std::vector<std::unique_ptr<EntityCommandBuffer>>   m_commandBuffers;
 
-	void		    removeDeadEntities(EntityVec& v);
+	void		    commitEntity(Entity& e);
+	void		    unlinkEntity(Entity& e);
+	void		    releaseEntity(Entity& e);
+	MatchList&      getMatchList(const ComponentSignature& mask, const ComponentSignature& exclude = {});
+	void		    playbackCommands();
 
 public:
 	EntityManager();
+	~EntityManager();
 
-	std::shared_ptr<Entity>         addEntity(const std::string& tag);
+	// sizes entity storage, component pools, tag buckets and match lists
+	// for n entities, including buckets and lists created later, so spawning
+	// up to n entities doesn't allocate for them
+	void                            reserve(size_t n);
+
+	Entity&                         addEntity(TagId tag);
+	Entity&                         addEntity(const std::string& tag);
 	EntityVec& getEntities();
+	// the bucket stays where it is when other tags are first asked for
+	EntityVec& getEntities(TagId tag);
 	EntityVec& getEntities(const std::string& tag);
 
+	// tag names are interned once into a process-wide table so entities
+	// and buckets can work with small integer ids
+	static TagId                    internTag(const std::string& name);
+	static const std::string&       tagName(TagId tag);
+
+	Entity*                         get(EntityHandle h);
+	const Entity*                   get(EntityHandle h) const;
+	bool                            isValid(EntityHandle h) const;
+
+	// Applies recorded commands, removes destroyed entities and commits new
+	// ones. Call from the main thread while no systems are running.
 	void                            update();
+
+	// handles of the committed entities the last update() removed, for
+	// systems that keep their own per-entity state
+	const std::vector<EntityHandle>& getDestroyed() const;
+
+	// The calling thread's command buffer. addEntity, destroy and
+	// add/removeComponent are main-thread only, workers record into this.
+	EntityCommandBuffer&            commands();
+
+	// entities with every component in Ts..., see View
+	template<typename... Ts>
+	View<Ts...> view() {
+		return View<Ts...>(this, &getMatchList(componentSignature<Ts...>()));
+	}
+
+	// entities with every component in Ts... and none in Xs...
+	template<typename... Ts, typename... Xs>
+	View<Ts...> view(Without<Xs...>) {
+		return View<Ts...>(this, &getMatchList(componentSignature<Ts...>(), componentSignature<Xs...>()));
+	}
+
+	// called by Entity when its component signature changes or it is destroyed
+	void                            onSignatureChanged(Entity& e);
+	void                            queueDestroy(Entity& e);
+	Entity&                         entityAt(std::uint32_t slot);
+
+	template<typename T>
+	ComponentPool<T>& getComponents() {
+		return std::get<ComponentPool<T>>(m_pools);
+	}
+
+	template<typename T>
+	const ComponentPool<T>& getComponents() const {
+		return std::get<ComponentPool<T>>(m_pools);
+	}
+};
+
+
+// Iterates the entities of a MatchList, yielding std::tuple<Ts&...>:
+//      for (auto [tfm, anim] : em.view<CTransform, CAnimation>()) ...
+// Don't add or remove the viewed component types while iterating.
+template<typename... Ts>
+class View
+{
+private:
+	EntityManager*      m_manager;
+	const MatchList*    m_list;
+
+public:
+	View(EntityManager* manager, const MatchList* list) : m_manager(manager), m_list(list) {}
+
+	class iterator
+	{
+	private:
+		EntityManager*          m_manager;
+		const std::uint32_t*    m_slot;
+
+	public:
+		iterator(EntityManager* manager, const std::uint32_t* slot) : m_manager(manager), m_slot(slot) {}
+
+		std::tuple<Ts&...> operator*() const {
+			return std::tuple<Ts&...>(m_manager->getComponents<Ts>().get(*m_slot)...);
+		}
+		iterator& operator++() { ++m_slot; return *this; }
+		bool operator==(const iterator& other) const { return m_slot == other.m_slot; }
+		bool operator!=(const iterator& other) const { return m_slot != other.m_slot; }
+	};
+
+	iterator begin() const { return iterator(m_manager, m_list->slots.data()); }
+	iterator end() const { return iterator(m_manager, m_list->slots.data() + m_list->slots.size()); }
+	size_t size() const { return m_list->slots.size(); }
+	bool empty() const { return m_list->slots.empty(); }
+
+	// random access, for splitting a view into ranges
+	std::tuple<Ts&...> operator[](size_t i) const {
+		return std::tuple<Ts&...>(m_manager->getComponents<Ts>().get(m_list->slots[i])...);
+	}
+	Entity& entity(size_t i) const { return m_manager->entityAt(m_list->slots[i]); }
+
+	// fn(Ts&...) or fn(Entity&, Ts&...)
+	template<typename F>
+	void each(F&& fn) const {
+		for (auto slot : m_list->slots) {
+			if constexpr (std::is_invocable_v<F, Entity&, Ts&...>)
+				fn(m_manager->entityAt(slot), m_manager->getComponents<Ts>().get(slot)...);
+			else
+				fn(m_manager->getComponents<Ts>().get(slot)...);
+		}
+	}
 };
 
 
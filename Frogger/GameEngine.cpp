@@ -3,6 +3,7 @@
 #include "Scene_Purr.h"
 #include "Scene_Menu.h"
 #include "Command.h"
+#include <algorithm>
 #include <fstream>
 #include <memory>
 #include <cstdlib>
@@ -31,7 +32,7 @@ void GameEngine::init(const std::string& path)
 	changeScene("MENU", std::make_shared<Scene_Menu>(this));
 }
 
-void GameEngine::loadConfigFromFile(const std::string& path, unsigned int& width, unsigned int& height) const {
+void GameEngine::loadConfigFromFile(const std::string& path, unsigned int& width, unsigned int& height) {
 	std::ifstream config(path);
 	if (config.fail()) {
 		std::cerr << "Open file " << path << " failed\n";
@@ -44,6 +45,13 @@ void GameEngine::loadConfigFromFile(const std::string& path, unsigned int& width
 		if (token == "Window") {
 			config >> width >> height;
 		}
+		else if (token == "Simulation") {
+			float rate;
+			config >> rate >> m_maxUpdatesPerFrame;
+			if (rate > 0.f)
+				m_timePerUpdate = sf::seconds(1.f / rate);
+			m_maxUpdatesPerFrame = std::max(m_maxUpdatesPerFrame, 1u);
+		}
 		else if (token[0] == '#') {
 			std::string tmp;
 			std::getline(config, tmp);
@@ -104,13 +112,14 @@ void GameEngine::changeScene(const std::string& sceneName, std::shared_ptr<Scene
 
 void GameEngine::quit()
 {
+	m_jobs.shutdown();
 	m_window.close();
 }
 
 
 void GameEngine::run()
 {
-	const sf::Time SPF = sf::seconds(1.0f / 60.f);  
+	const sf::Time SPF = m_timePerUpdate;
 
 	sf::Clock clock;
 	sf::Time timeSinceLastUpdate = sf::Time::Zero;
@@ -120,12 +129,20 @@ void GameEngine::run()
 		sUserInput();								
 
 		timeSinceLastUpdate += clock.restart();
-		while (timeSinceLastUpdate > SPF)
+		unsigned int updates = 0;
+		while (timeSinceLastUpdate >= SPF && updates < m_maxUpdatesPerFrame)
 		{
 			currentScene()->update(SPF);			
 			timeSinceLastUpdate -= SPF;
+			++updates;
 		}
 
+		// too far behind to catch up: drop the backlog rather than let
+		// every frame spend longer simulating than the last
+		if (timeSinceLastUpdate >= SPF)
+			timeSinceLastUpdate %= SPF;
+
+		currentScene()->setRenderAlpha(timeSinceLastUpdate / SPF);
 		currentScene()->sRender();					
 
 		window().display();
@@ -147,6 +164,11 @@ sf::RenderWindow& GameEngine::window()
 	return m_window;
 }
 
+JobSystem& GameEngine::jobs()
+{
+	return m_jobs;
+}
+
 sf::Vector2f GameEngine::windowSize() const {
 	return sf::Vector2f{ m_window.getSize() };
 }
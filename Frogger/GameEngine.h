@@ -2,6 +2,7 @@
 
 
 #include "Assets.h"
+#include "JobSystem.h"
 
 #include <memory>
 #include <map>
@@ -16,11 +17,14 @@ class GameEngine
 public:
 	sf::RenderWindow	        m_window;
 	std::string			        m_currentScene;
+	JobSystem			        m_jobs;
 	SceneMap			        m_sceneMap;
 	size_t				        m_simulationSpeed{ 1 };
+	sf::Time			        m_timePerUpdate{ sf::seconds(1.f / 60.f) };
+	unsigned int		        m_maxUpdatesPerFrame{ 5 };
 	bool				        m_running{ true };
 
-	void						loadConfigFromFile(const std::string &path, unsigned int &width, unsigned int &height) const;
+	void						loadConfigFromFile(const std::string &path, unsigned int &width, unsigned int &height);
 	void						init(const std::string& path);
 	void						sUserInput();
 	std::shared_ptr<Scene>		currentScene();
@@ -44,6 +48,7 @@ public:
 	void				backLevel();
 
 	sf::RenderWindow&	window();
+	JobSystem&			jobs();
 
 	sf::Vector2f		windowSize() const;
 	bool				isRunning();
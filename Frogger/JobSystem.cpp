@@ -0,0 +1,171 @@
+#include "JobSystem.h"
+
+namespace {
+	// which JobSystem worker, if any, the current thread is
+	thread_local const JobSystem*   t_owner = nullptr;
+	thread_local int                t_queue = -1;
+
+	thread_local JobSystem::WorkId  t_work;
+}
+
+
+JobSystem::WorkScope::WorkScope(WorkId id)
+	: m_previous(t_work) {
+	t_work = id;
+}
+
+
+JobSystem::WorkScope::~WorkScope() {
+	t_work = m_previous;
+}
+
+
+JobSystem::WorkId JobSystem::currentWork() {
+	return t_work;
+}
+
+
+JobSystem::JobSystem(unsigned threadCount) {
+	if (threadCount == 0) {
+		auto hw = std::thread::hardware_concurrency();
+		threadCount = hw > 1 ? hw - 1 : 0;
+	}
+
+	for (unsigned i = 0; i < threadCount; ++i)
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	for (unsigned i = 0; i < threadCount; ++i)
+		m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+
+JobSystem::~JobSystem() {
+	shutdown();
+}
+
+
+void JobSystem::shutdown() {
+	if (m_workers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	// workers drain whatever is still queued before they exit
+	for (auto& worker : m_workers)
+		worker.join();
+	m_workers.clear();
+}
+
+
+void JobSystem::submit(Counter& counter, std::function<void()> job) {
+	counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+	// no workers, nothing to hand the job to
+	if (m_workers.empty()) {
+		Job inlineJob{ std::move(job), &counter };
+		execute(inlineJob);
+		return;
+	}
+
+	// workers keep their own jobs local, other threads spread them round-robin
+	int own = currentQueue();
+	auto index = own >= 0 ? static_cast<unsigned>(own)
+		: m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+	{
+		std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+		m_queues[index]->jobs.push_back(Job{ std::move(job), &counter });
+	}
+	m_queued.fetch_add(1, std::memory_order_release);
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_wake.notify_one();
+}
+
+
+void JobSystem::wait(Counter& counter) {
+	int own = currentQueue();
+	while (counter.pending.load(std::memory_order_acquire) > 0) {
+		if (!runOne(own))
+			std::this_thread::yield();
+	}
+}
+
+
+unsigned JobSystem::threadCount() const {
+	return static_cast<unsigned>(m_workers.size());
+}
+
+
+void JobSystem::workerLoop(unsigned index) {
+	t_owner = this;
+	t_queue = static_cast<int>(index);
+
+	while (true) {
+		if (runOne(t_queue))
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this] { return m_stopping || m_queued.load(std::memory_order_acquire) > 0; });
+		if (m_stopping && m_queued.load(std::memory_order_acquire) == 0)
+			return;
+	}
+}
+
+
+bool JobSystem::runOne(int ownQueue) {
+	Job job;
+	bool found = ownQueue >= 0 && popOwn(static_cast<unsigned>(ownQueue), job);
+	if (!found)
+		found = steal(ownQueue >= 0 ? static_cast<unsigned>(ownQueue) : 0, job);
+	if (!found)
+		return false;
+
+	execute(job);
+	return true;
+}
+
+
+bool JobSystem::popOwn(unsigned index, Job& job) {
+	auto& queue = *m_queues[index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty())
+		return false;
+
+	job = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+	m_queued.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+
+bool JobSystem::steal(unsigned thief, Job& job) {
+	auto count = static_cast<unsigned>(m_queues.size());
+	for (unsigned k = 0; k < count; ++k) {
+		auto& queue = *m_queues[(thief + k) % count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			continue;
+
+		job = std::move(queue.jobs.front());
+		queue.jobs.pop_front();
+		m_queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+
+int JobSystem::currentQueue() const {
+	return t_owner == this ? t_queue : -1;
+}
+
+
+void JobSystem::execute(Job& job) {
+	job.fn();
+	job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Work-stealing worker pool owned by the GameEngine. Every worker has its own
+// deque: it pushes and pops at the back, idle workers steal from the front of
+// the others. Jobs are grouped by a Counter the caller waits on; a waiting
+// thread runs jobs itself instead of blocking, so jobs may submit and wait on
+// further jobs (the scheduler's systems call parallelFor).
+class JobSystem
+{
+public:
+	struct Counter {
+		std::atomic<int>    pending{ 0 };
+	};
+
+	static constexpr size_t DefaultChunkSize = 256;
+
+	// Which piece of work the calling thread is doing: a job number chosen
+	// by whoever started it (SystemScheduler uses the system) and the
+	// parallelFor chunk, both 1-based and 0 outside. Unlike which thread
+	// runs what, this is the same on every run, so recorders such as
+	// EntityCommandBuffer order their output by it.
+	struct WorkId {
+		std::uint32_t   job{ 0 };
+		std::uint32_t   chunk{ 0 };
+	};
+
+	// makes id the calling thread's WorkId until destroyed
+	class WorkScope {
+		WorkId          m_previous;
+	public:
+		explicit WorkScope(WorkId id);
+		~WorkScope();
+		WorkScope(const WorkScope&) = delete;
+		WorkScope& operator=(const WorkScope&) = delete;
+	};
+
+private:
+	struct Job {
+		std::function<void()>   fn;
+		Counter*                counter{ nullptr };
+	};
+
+	struct WorkQueue {
+		std::mutex              mutex;
+		std::deque<Job>         jobs;
+	};
+
+	std::vector<std::thread>                    m_workers;
+	std::vector<std::unique_ptr<WorkQueue>>     m_queues;       // one per worker
+	std::atomic<int>                            m_queued{ 0 };
+	std::atomic<unsigned>                       m_nextQueue{ 0 };
+	std::mutex                                  m_sleepMutex;
+	std::condition_variable                     m_wake;
+	bool                                        m_stopping{ false };
+
+	void                        workerLoop(unsigned index);
+	bool                        runOne(int ownQueue);
+	bool                        popOwn(unsigned index, Job& job);
+	bool                        steal(unsigned thief, Job& job);
+	int                         currentQueue() const;
+	static void                 execute(Job& job);
+
+public:
+	// threadCount 0 picks one worker per hardware thread, minus the main thread
+	explicit JobSystem(unsigned threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void                        submit(Counter& counter, std::function<void()> job);
+	void                        wait(Counter& counter);
+
+	// Joins the workers. Jobs submitted afterwards run inline on the caller.
+	void                        shutdown();
+
+	unsigned                    threadCount() const;
+
+	static WorkId               currentWork();
+
+	// Calls fn(i) for every i in [begin, end), split into chunkSize ranges.
+	// Ranges that fit in one chunk, or a pool without workers, run inline.
+	// Each range runs with the caller's job and its own chunk number; a
+	// parallelFor nested in another numbers its chunks afresh.
+	template<typename F>
+	void parallelFor(size_t begin, size_t end, size_t chunkSize, F&& fn) {
+		chunkSize = std::max<size_t>(chunkSize, 1);
+		auto job = currentWork().job;
+		if (end <= begin + chunkSize || m_workers.empty()) {
+			// one thread in index order, the same order as the chunks
+			WorkScope scope(WorkId{ job, 1 });
+			for (size_t i = begin; i < end; ++i)
+				fn(i);
+			return;
+		}
+
+		Counter counter;
+		std::uint32_t chunk = 1;
+		for (size_t first = begin + chunkSize; first < end; first += chunkSize) {
+			size_t last = std::min(first + chunkSize, end);
+			submit(counter, [&fn, first, last, id = WorkId{ job, ++chunk }] {
+				WorkScope scope(id);
+				for (size_t i = first; i < last; ++i)
+					fn(i);
+			});
+		}
+
+		// first chunk on this thread, then help with the rest
+		{
+			WorkScope scope(WorkId{ job, 1 });
+			for (size_t i = begin; i < begin + chunkSize; ++i)
+				fn(i);
+		}
+		wait(counter);
+	}
+};
@@ -1,43 +1,492 @@
 #include "Physics.h"
+#include "StaticBvh.h"
+#include "EntityManager.h"
+#include "EntityCommandBuffer.h"
+#include "JobSystem.h"
 #include <cmath>
+#include <cassert>
+#include <limits>
 
-sf::Vector2f Physics::getOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b)
-{
-    sf::Vector2f overlap(0.f, 0.f);
-    if (!a->hasComponent<CBoundingBox>() or !b->hasComponent<CBoundingBox>())
-        return overlap;
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PHYSICS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PHYSICS_TARGET(isa)
+#else
+#define PHYSICS_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define PHYSICS_X86 0
+#endif
+
+namespace {
+    // Every kernel handles [first, n); the SIMD ones do whole vectors and
+    // leave the tail to the scalar one.
+    struct Kernels
+    {
+        void (*oneVsMany)(sf::Vector2f, sf::Vector2f, const Physics::AabbSpan&, const Physics::OverlapSpan&);
+        void (*pairwise)(const Physics::AabbSpan&, const Physics::AabbSpan&, const Physics::OverlapSpan&);
+        const char* name;
+    };
+
+    void oneVsManyScalar(sf::Vector2f c, sf::Vector2f h, const Physics::AabbSpan& b,
+        const Physics::OverlapSpan& out, size_t first)
+    {
+        for (size_t i = first; i < b.size(); ++i) {
+            out.x[i] = h.x + b.hx[i] - std::abs(c.x - b.cx[i]);
+            out.y[i] = h.y + b.hy[i] - std::abs(c.y - b.cy[i]);
+        }
+    }
+
+    void pairwiseScalar(const Physics::AabbSpan& a, const Physics::AabbSpan& b,
+        const Physics::OverlapSpan& out, size_t first)
+    {
+        for (size_t i = first; i < a.size(); ++i) {
+            out.x[i] = a.hx[i] + b.hx[i] - std::abs(a.cx[i] - b.cx[i]);
+            out.y[i] = a.hy[i] + b.hy[i] - std::abs(a.cy[i] - b.cy[i]);
+        }
+    }
+
+    void oneVsManyScalar(sf::Vector2f c, sf::Vector2f h, const Physics::AabbSpan& b, const Physics::OverlapSpan& out)
+    {
+        oneVsManyScalar(c, h, b, out, 0);
+    }
+
+    void pairwiseScalar(const Physics::AabbSpan& a, const Physics::AabbSpan& b, const Physics::OverlapSpan& out)
+    {
+        pairwiseScalar(a, b, out, 0);
+    }
+
+#if PHYSICS_X86
+    PHYSICS_TARGET("sse2")
+    void oneVsManySse(sf::Vector2f c, sf::Vector2f h, const Physics::AabbSpan& b, const Physics::OverlapSpan& out)
+    {
+        const __m128 sign = _mm_set1_ps(-0.f);
+        const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y);
+        const __m128 hx = _mm_set1_ps(h.x), hy = _mm_set1_ps(h.y);
+
+        size_t i = 0;
+        for (; i + 4 <= b.size(); i += 4) {
+            __m128 dx = _mm_andnot_ps(sign, _mm_sub_ps(cx, _mm_loadu_ps(&b.cx[i])));
+            __m128 dy = _mm_andnot_ps(sign, _mm_sub_ps(cy, _mm_loadu_ps(&b.cy[i])));
+            _mm_storeu_ps(&out.x[i], _mm_sub_ps(_mm_add_ps(hx, _mm_loadu_ps(&b.hx[i])), dx));
+            _mm_storeu_ps(&out.y[i], _mm_sub_ps(_mm_add_ps(hy, _mm_loadu_ps(&b.hy[i])), dy));
+        }
+        oneVsManyScalar(c, h, b, out, i);
+    }
+
+    PHYSICS_TARGET("sse2")
+    void pairwiseSse(const Physics::AabbSpan& a, const Physics::AabbSpan& b, const Physics::OverlapSpan& out)
+    {
+        const __m128 sign = _mm_set1_ps(-0.f);
+
+        size_t i = 0;
+        for (; i + 4 <= a.size(); i += 4) {
+            __m128 dx = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(&a.cx[i]), _mm_loadu_ps(&b.cx[i])));
+            __m128 dy = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(&a.cy[i]), _mm_loadu_ps(&b.cy[i])));
+            _mm_storeu_ps(&out.x[i], _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&a.hx[i]), _mm_loadu_ps(&b.hx[i])), dx));
+            _mm_storeu_ps(&out.y[i], _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&a.hy[i]), _mm_loadu_ps(&b.hy[i])), dy));
+        }
+        pairwiseScalar(a, b, out, i);
+    }
+
+    PHYSICS_TARGET("avx2")
+    void oneVsManyAvx2(sf::Vector2f c, sf::Vector2f h, const Physics::AabbSpan& b, const Physics::OverlapSpan& out)
+    {
+        const __m256 sign = _mm256_set1_ps(-0.f);
+        const __m256 cx = _mm256_set1_ps(c.x), cy = _mm256_set1_ps(c.y);
+        const __m256 hx = _mm256_set1_ps(h.x), hy = _mm256_set1_ps(h.y);
+
+        size_t i = 0;
+        for (; i + 8 <= b.size(); i += 8) {
+            __m256 dx = _mm256_andnot_ps(sign, _mm256_sub_ps(cx, _mm256_loadu_ps(&b.cx[i])));
+            __m256 dy = _mm256_andnot_ps(sign, _mm256_sub_ps(cy, _mm256_loadu_ps(&b.cy[i])));
+            _mm256_storeu_ps(&out.x[i], _mm256_sub_ps(_mm256_add_ps(hx, _mm256_loadu_ps(&b.hx[i])), dx));
+            _mm256_storeu_ps(&out.y[i], _mm256_sub_ps(_mm256_add_ps(hy, _mm256_loadu_ps(&b.hy[i])), dy));
+        }
+        oneVsManyScalar(c, h, b, out, i);
+    }
+
+    PHYSICS_TARGET("avx2")
+    void pairwiseAvx2(const Physics::AabbSpan& a, const Physics::AabbSpan& b, const Physics::OverlapSpan& out)
+    {
+        const __m256 sign = _mm256_set1_ps(-0.f);
+
+        size_t i = 0;
+        for (; i + 8 <= a.size(); i += 8) {
+            __m256 dx = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(&a.cx[i]), _mm256_loadu_ps(&b.cx[i])));
+            __m256 dy = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(&a.cy[i]), _mm256_loadu_ps(&b.cy[i])));
+            _mm256_storeu_ps(&out.x[i], _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(&a.hx[i]), _mm256_loadu_ps(&b.hx[i])), dx));
+            _mm256_storeu_ps(&out.y[i], _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(&a.hy[i]), _mm256_loadu_ps(&b.hy[i])), dy));
+        }
+        pairwiseScalar(a, b, out, i);
+    }
+
+    bool cpuHasSse2()
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+        return true;
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+#else
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
 
-    auto atx = a->getComponent<CTransform>();
-    auto abb = a->getComponent<CBoundingBox>();
-    auto btx = b->getComponent<CTransform>();
-    auto bbb = b->getComponent<CBoundingBox>();
+    bool cpuHasAvx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // the OS has to save the YMM registers too
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    struct KernelTable
+    {
+        std::vector<Kernels> available;     // best first
+        const Kernels* selected;
+    };
+
+    KernelTable makeKernelTable()
+    {
+        KernelTable table;
+#if PHYSICS_X86
+        if (cpuHasAvx2())
+            table.available.push_back(Kernels{ oneVsManyAvx2, pairwiseAvx2, "avx2" });
+        if (cpuHasSse2())
+            table.available.push_back(Kernels{ oneVsManySse, pairwiseSse, "sse2" });
+#endif
+        table.available.push_back(Kernels{ oneVsManyScalar, pairwiseScalar, "scalar" });
+        table.selected = &table.available.front();
+        return table;
+    }
 
+    KernelTable& kernelTable()
+    {
+        static KernelTable table = makeKernelTable();
+        return table;
+    }
 
-    if (abb.has && bbb.has)
+    const Kernels& kernels()
     {
-        float dx = std::abs(atx.pos.x - btx.pos.x);
-        float dy = std::abs(atx.pos.y - btx.pos.y);
-        overlap = sf::Vector2f(abb.halfSize.x + bbb.halfSize.x - dx, abb.halfSize.y + bbb.halfSize.y - dy);
+        return *kernelTable().selected;
     }
+}
+
+sf::Vector2f Physics::getOverlap(const Entity& a, const Entity& b)
+{
+    sf::Vector2f overlap(0.f, 0.f);
+    if (!a.hasComponent<CBoundingBox>() or !b.hasComponent<CBoundingBox>()
+        or !a.hasComponent<CTransform>() or !b.hasComponent<CTransform>())
+        return overlap;
+
+    auto& atx = a.getComponent<CTransform>();
+    auto& abb = a.getComponent<CBoundingBox>();
+    auto& btx = b.getComponent<CTransform>();
+    auto& bbb = b.getComponent<CBoundingBox>();
+
+    float dx = std::abs(atx.pos.x - btx.pos.x);
+    float dy = std::abs(atx.pos.y - btx.pos.y);
+    overlap = sf::Vector2f(abb.halfSize.x + bbb.halfSize.x - dx, abb.halfSize.y + bbb.halfSize.y - dy);
     return overlap;
 }
 
-sf::Vector2f Physics::getPreviousOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b)
+sf::Vector2f Physics::getPreviousOverlap(const Entity& a, const Entity& b)
 {
     sf::Vector2f overlap(0.f, 0.f);
-    if (!a->hasComponent<CBoundingBox>() or !b->hasComponent<CBoundingBox>())
+    if (!a.hasComponent<CBoundingBox>() or !b.hasComponent<CBoundingBox>()
+        or !a.hasComponent<CTransform>() or !b.hasComponent<CTransform>())
         return overlap;
 
-    auto atx = a->getComponent<CTransform>();
-    auto abb = a->getComponent<CBoundingBox>();
-    auto btx = b->getComponent<CTransform>();
-    auto bbb = b->getComponent<CBoundingBox>();
+    auto& atx = a.getComponent<CTransform>();
+    auto& abb = a.getComponent<CBoundingBox>();
+    auto& btx = b.getComponent<CTransform>();
+    auto& bbb = b.getComponent<CBoundingBox>();
 
-    if (abb.has && bbb.has)
-    {
-        float dx = std::abs(atx.prevPos.x - btx.prevPos.x);
-        float dy = std::abs(atx.prevPos.y - btx.prevPos.y);
-        overlap = sf::Vector2f(abb.halfSize.x + bbb.halfSize.x - dx, abb.halfSize.y + bbb.halfSize.y - dy);
-    }
+    float dx = std::abs(atx.prevPos.x - btx.prevPos.x);
+    float dy = std::abs(atx.prevPos.y - btx.prevPos.y);
+    overlap = sf::Vector2f(abb.halfSize.x + bbb.halfSize.x - dx, abb.halfSize.y + bbb.halfSize.y - dy);
     return overlap;
 }
+
+sf::FloatRect Physics::getBounds(const Entity& e)
+{
+    auto& pos = e.getComponent<CTransform>().pos;
+    auto& half = e.getComponent<CBoundingBox>().halfSize;
+    return sf::FloatRect(pos.x - half.x, pos.y - half.y, 2.f * half.x, 2.f * half.y);
+}
+
+bool Physics::sweep(const sf::FloatRect& box, sf::Vector2f delta, const sf::FloatRect& target, SweepHit& hit)
+{
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    // entry and exit times of the box's centre through target grown by the half size
+    auto slab = [](float c, float half, float lo, float hi, float d, float& entry, float& exit) {
+        lo -= half;
+        hi += half;
+        if (d == 0.f) {
+            entry = -inf;
+            exit = inf;
+            return c > lo && c < hi;
+        }
+        float t0 = (lo - c) / d;
+        float t1 = (hi - c) / d;
+        entry = std::min(t0, t1);
+        exit = std::max(t0, t1);
+        return true;
+    };
+
+    sf::Vector2f half(0.5f * box.width, 0.5f * box.height);
+    sf::Vector2f c(box.left + half.x, box.top + half.y);
+
+    float entryX, exitX, entryY, exitY;
+    if (!slab(c.x, half.x, target.left, target.left + target.width, delta.x, entryX, exitX)
+        || !slab(c.y, half.y, target.top, target.top + target.height, delta.y, entryY, exitY))
+        return false;
+
+    float entry = std::max(entryX, entryY);
+    float exit = std::min(exitX, exitY);
+    if (entry >= exit || entry < 0.f || entry > 1.f)
+        return false;
+
+    hit.time = entry;
+    if (entryX > entryY)
+        hit.normal = sf::Vector2f(delta.x > 0.f ? -1.f : 1.f, 0.f);
+    else
+        hit.normal = sf::Vector2f(0.f, delta.y > 0.f ? -1.f : 1.f);
+    return true;
+}
+
+CollisionFilter Physics::getFilter(const Entity& e)
+{
+    if (e.hasComponent<CCollisionFilter>())
+        return e.getComponent<CCollisionFilter>().filter;
+    return CollisionFilter{};
+}
+
+void Physics::integrate(EntityManager& entities, JobSystem& jobs, sf::Time dt, std::uint16_t sleepFrames, size_t chunkSize)
+{
+    auto view = entities.view<CTransform>(Without<CSleeping>{});
+    jobs.parallelFor(0, view.size(), chunkSize, [&entities, &view, dt, sleepFrames](size_t i) {
+        // runs first, so prevPos is where everything was at the start of the frame
+        auto [tfm] = view[i];
+        tfm.prevPos = tfm.pos;
+        auto& e = view.entity(i);
+        if (e.hasComponent<CCharacterController>()) return;
+
+        // put bodies that stopped moving to sleep, it takes effect next update
+        // unless setVelocity or setPosition reset stillFrames before then
+        if (tfm.vel == sf::Vector2f(0.f, 0.f) && tfm.angVel == 0.f) {
+            if (++tfm.stillFrames == sleepFrames) {
+                entities.commands().modify(e.getHandle(), [sleepFrames](Entity& e) {
+                    if (!e.hasComponent<CTransform>() || e.getComponent<CTransform>().stillFrames < sleepFrames)
+                        return;
+                    e.getComponent<CTransform>().stillFrames = 0;
+                    e.addComponent<CSleeping>();
+                });
+            }
+            return;
+        }
+        tfm.stillFrames = 0;
+
+        tfm.pos += tfm.vel * dt.asSeconds();
+        tfm.angle += tfm.angVel * dt.asSeconds();
+    });
+}
+
+void Physics::wake(Entity& e, EntityCommandBuffer& commands)
+{
+    // always recorded: a sleep integrate queued this frame isn't visible
+    // yet. Either playback order leaves the body awake, the sleep checks
+    // stillFrames and this resets it.
+    commands.modify(e.getHandle(), [](Entity& e) {
+        e.removeComponent<CSleeping>();
+        if (e.hasComponent<CTransform>())
+            e.getComponent<CTransform>().stillFrames = 0;
+    });
+}
+
+// the caller may write CTransform, so resetting stillFrames right away
+// cancels a pending sleep; only a body already asleep needs a command
+void Physics::setVelocity(Entity& e, sf::Vector2f vel, EntityCommandBuffer& commands)
+{
+    auto& tfm = e.getComponent<CTransform>();
+    tfm.vel = vel;
+    tfm.stillFrames = 0;
+    if (e.hasComponent<CSleeping>())
+        wake(e, commands);
+}
+
+void Physics::setPosition(Entity& e, sf::Vector2f pos, EntityCommandBuffer& commands)
+{
+    auto& tfm = e.getComponent<CTransform>();
+    tfm.pos = pos;
+    tfm.stillFrames = 0;
+    if (e.hasComponent<CSleeping>())
+        wake(e, commands);
+}
+
+void Physics::queryOverlaps(Broadphase& broadphase, Entity& e, std::vector<EntityHandle>& out)
+{
+    auto self = e.getHandle();
+    auto first = out.size();
+    broadphase.query(getBounds(e), out, getFilter(e));
+    out.erase(std::remove(out.begin() + first, out.end(), self), out.end());
+}
+
+void Physics::raycast(Broadphase& broadphase, sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out,
+    const CollisionFilter& filter)
+{
+    auto first = out.size();
+    broadphase.queryRay(origin, delta, out, filter);
+    std::sort(out.begin() + first, out.end(), [](const RayHit& a, const RayHit& b) { return a.time < b.time; });
+}
+
+bool Physics::raycast(const StaticBvh& world, sf::Vector2f origin, sf::Vector2f delta, RayHit& hit, std::uint32_t mask)
+{
+    // a ray is a sweep of an empty box
+    SweepHit sweepHit;
+    if (!world.sweep(sf::FloatRect(origin, sf::Vector2f(0.f, 0.f)), delta, sweepHit, mask))
+        return false;
+
+    hit.handle = EntityHandle{};
+    hit.time = sweepHit.time;
+    hit.normal = sweepHit.normal;
+    return true;
+}
+
+void Physics::queryPoint(Broadphase& broadphase, sf::Vector2f p, std::vector<EntityHandle>& out,
+    const CollisionFilter& filter)
+{
+    broadphase.queryPoint(p, out, filter);
+}
+
+void Physics::queryRegion(Broadphase& broadphase, const sf::FloatRect& region, std::vector<EntityHandle>& out,
+    const CollisionFilter& filter)
+{
+    broadphase.query(region, out, filter);
+}
+
+void Physics::queryNearest(Broadphase& broadphase, sf::Vector2f p, size_t n, float maxDistance,
+    std::vector<EntityHandle>& out, const CollisionFilter& filter)
+{
+    auto first = out.size();
+    broadphase.query(sf::FloatRect(p.x - maxDistance, p.y - maxDistance, 2.f * maxDistance, 2.f * maxDistance),
+        out, filter);
+
+    // squared distance from p to the closest point of the AABB
+    auto distance = [&](EntityHandle h) {
+        auto b = broadphase.getBounds(h);
+        float dx = std::max({ b.left - p.x, 0.f, p.x - (b.left + b.width) });
+        float dy = std::max({ b.top - p.y, 0.f, p.y - (b.top + b.height) });
+        return dx * dx + dy * dy;
+    };
+
+    // the square catches the corners beyond maxDistance too
+    out.erase(std::remove_if(out.begin() + first, out.end(),
+        [&](EntityHandle h) { return distance(h) > maxDistance * maxDistance; }), out.end());
+
+    auto last = out.begin() + std::min(out.size(), first + n);
+    std::partial_sort(out.begin() + first, last, out.end(),
+        [&](EntityHandle a, EntityHandle b) { return distance(a) < distance(b); });
+    out.erase(last, out.end());
+}
+
+void Physics::AabbBatch::clear()
+{
+    cx.clear();
+    cy.clear();
+    hx.clear();
+    hy.clear();
+}
+
+void Physics::AabbBatch::reserve(size_t n)
+{
+    cx.reserve(n);
+    cy.reserve(n);
+    hx.reserve(n);
+    hy.reserve(n);
+}
+
+size_t Physics::AabbBatch::size() const
+{
+    return cx.size();
+}
+
+void Physics::AabbBatch::push(const sf::Vector2f& center, const sf::Vector2f& halfSize)
+{
+    cx.push_back(center.x);
+    cy.push_back(center.y);
+    hx.push_back(halfSize.x);
+    hy.push_back(halfSize.y);
+}
+
+void Physics::AabbBatch::push(const Entity& e)
+{
+    push(e.getComponent<CTransform>().pos, e.getComponent<CBoundingBox>().halfSize);
+}
+
+void Physics::AabbBatch::pushPrevious(const Entity& e)
+{
+    push(e.getComponent<CTransform>().prevPos, e.getComponent<CBoundingBox>().halfSize);
+}
+
+Physics::AabbSpan Physics::AabbBatch::span() const
+{
+    return AabbSpan{ cx, cy, hx, hy };
+}
+
+void Physics::getOverlaps(sf::Vector2f center, sf::Vector2f halfSize, const AabbSpan& others, const OverlapSpan& out)
+{
+    assert(out.x.size() >= others.size() && out.y.size() >= others.size());
+    kernels().oneVsMany(center, halfSize, others, out);
+}
+
+void Physics::getOverlaps(const AabbSpan& a, const AabbSpan& b, const OverlapSpan& out)
+{
+    assert(b.size() >= a.size() && out.x.size() >= a.size() && out.y.size() >= a.size());
+    kernels().pairwise(a, b, out);
+}
+
+const char* Physics::getBatchKernel()
+{
+    return kernels().name;
+}
+
+std::vector<const char*> Physics::getBatchKernels()
+{
+    std::vector<const char*> names;
+    for (auto& k : kernelTable().available)
+        names.push_back(k.name);
+    return names;
+}
+
+bool Physics::setBatchKernel(std::string_view name)
+{
+    auto& table = kernelTable();
+    for (auto& k : table.available) {
+        if (name == k.name) {
+            table.selected = &k;
+            return true;
+        }
+    }
+    return false;
+}
@@ -2,6 +2,7 @@
 
 
 #include "Entity.h"
+#include "Broadphase.h"
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
@@ -12,11 +13,114 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <span>
+#include <string_view>
+
+class StaticBvh;
+class EntityManager;
+class EntityCommandBuffer;
+class JobSystem;
 
 
 namespace Physics
 {
-	sf::Vector2f getOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b);
-    sf::Vector2f getPreviousOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b);
+	sf::Vector2f getOverlap(const Entity& a, const Entity& b);
+    sf::Vector2f getPreviousOverlap(const Entity& a, const Entity& b);
+
+    // world space AABB from CTransform and CBoundingBox
+    sf::FloatRect getBounds(const Entity& e);
+
+    // e's CCollisionFilter, or the default filter if it has none
+    CollisionFilter getFilter(const Entity& e);
+
+    // Moves every awake CTransform by its velocity. Bodies without velocity
+    // for sleepFrames updates in a row get a CSleeping, which takes effect
+    // on the next EntityManager::update(). Character controllers move
+    // themselves and never sleep.
+    void integrate(EntityManager& entities, JobSystem& jobs, sf::Time dt, std::uint16_t sleepFrames, size_t chunkSize);
+
+    // Puts a sleeping entity back into movement and the broadphase from the
+    // next update on, and cancels a sleep integrate queued this frame.
+    // Recorded in commands, so safe from any system.
+    void wake(Entity& e, EntityCommandBuffer& commands);
+    // gameplay writes to a body go through these so that it wakes up, or
+    // doesn't fall asleep at the next update
+    void setVelocity(Entity& e, sf::Vector2f vel, EntityCommandBuffer& commands);
+    void setPosition(Entity& e, sf::Vector2f pos, EntityCommandBuffer& commands);
+
+    // Structure-of-arrays boxes for the batch kernels below: centres and
+    // half sizes in separate float arrays of equal length.
+    struct AabbSpan
+    {
+        std::span<const float> cx, cy, hx, hy;
+
+        size_t size() const { return cx.size(); }
+    };
+
+    struct OverlapSpan
+    {
+        std::span<float> x, y;
+    };
+
+    // Owning storage for AabbSpan, reused between frames
+    struct AabbBatch
+    {
+        std::vector<float> cx, cy, hx, hy;
+
+        void clear();
+        void reserve(size_t n);
+        size_t size() const;
+        void push(const sf::Vector2f& center, const sf::Vector2f& halfSize);
+        void push(const Entity& e);
+        void pushPrevious(const Entity& e);
+        AabbSpan span() const;
+    };
+
+    // Batch versions of getOverlap. out[i] receives the per-axis overlap,
+    // positive on both axes when the boxes intersect. Uses AVX2 or SSE2
+    // when the CPU has them, picked once on first use.
+    void getOverlaps(sf::Vector2f center, sf::Vector2f halfSize, const AabbSpan& others, const OverlapSpan& out);
+    void getOverlaps(const AabbSpan& a, const AabbSpan& b, const OverlapSpan& out);     // a[i] against b[i]
+
+    // name of the kernel set getOverlaps dispatches to
+    const char* getBatchKernel();
+    // the kernel sets this CPU can run, best first
+    std::vector<const char*> getBatchKernels();
+    // makes getOverlaps use the named kernel set, false if the CPU can't run
+    // it. Not thread safe, for tests and benchmarks.
+    bool setBatchKernel(std::string_view name);
+
+    struct SweepHit
+    {
+        float           time{ 1.f };        // fraction of delta travelled before touching
+        sf::Vector2f    normal{ 0.f, 0.f }; // face of target that was hit
+    };
+
+    // Moves box by delta and finds when it first touches target (swept AABB,
+    // slab test on target grown by box's half size). Boxes that already
+    // overlap at the start don't count as hits.
+    bool sweep(const sf::FloatRect& box, sf::Vector2f delta, const sf::FloatRect& target, SweepHit& hit);
+
+    // appends the entities in broadphase overlapping e that e's filter
+    // accepts, e itself excluded
+    void queryOverlaps(Broadphase& broadphase, Entity& e, std::vector<EntityHandle>& out);
+
+    // Spatial queries for gameplay, culling and AI. They append to the
+    // caller's buffer and allocate nothing once it has grown.
+    using RayHit = Broadphase::RayHit;
+
+    // entities the segment origin -> origin + delta enters, nearest first
+    void raycast(Broadphase& broadphase, sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out,
+        const CollisionFilter& filter = {});
+    // first static collider the segment enters, handle is left null
+    bool raycast(const StaticBvh& world, sf::Vector2f origin, sf::Vector2f delta, RayHit& hit,
+        std::uint32_t mask = CollisionFilter::ALL);
+    void queryPoint(Broadphase& broadphase, sf::Vector2f p, std::vector<EntityHandle>& out,
+        const CollisionFilter& filter = {});
+    void queryRegion(Broadphase& broadphase, const sf::FloatRect& region, std::vector<EntityHandle>& out,
+        const CollisionFilter& filter = {});
+    // up to n entities whose AABB is within maxDistance of p, nearest first
+    void queryNearest(Broadphase& broadphase, sf::Vector2f p, size_t n, float maxDistance,
+        std::vector<EntityHandle>& out, const CollisionFilter& filter = {});
 };
 
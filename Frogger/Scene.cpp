@@ -16,6 +16,11 @@ void Scene::setPaused(bool paused)
 void Scene::simulate(int)
 {}
 
+void Scene::setRenderAlpha(float alpha)
+{
+	m_renderAlpha = alpha;
+}
+
 void Scene::doAction(Command command)
 {
 	this->sDoAction(command);
@@ -3,6 +3,7 @@
 #include "EntityManager.h"
 #include "GameEngine.h"
 #include "Command.h"
+#include "SystemScheduler.h"
 #include <map>
 #include <string>
 
@@ -18,10 +19,12 @@ protected:
 
 	GameEngine	    *m_game;
 	EntityManager	m_entityManager;
+	SystemScheduler	m_systems;
 	CommandMap		m_commands;
 	bool			m_isPaused{false};
 	bool			m_hasEnded{false};
 	size_t			m_currentFrame{ 0 };
+	float			m_renderAlpha{ 1.f };	// how far render time is between the last two updates
 
 	virtual void	onEnd() = 0;
 	void			setPaused(bool paused);
@@ -35,6 +38,7 @@ public:
 	virtual void		sRender() = 0;
 
 	void				simulate(int);
+	void				setRenderAlpha(float alpha);
 	void				doAction(Command);
 	void				registerAction(int, std::string);
 	const CommandMap	getActionMap() const;
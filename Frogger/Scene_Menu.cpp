@@ -74,7 +74,7 @@ void Scene_Menu::sRender()
 	view.setCenter(m_game->window().getSize().x / 2.f, m_game->window().getSize().y / 2.f);
 	m_game->window().setView(view);
 
-	m_game->window().draw(m_background);
+	m_backgroundLayer.draw(m_game->window(), [this](sf::RenderTarget& target) { target.draw(m_background); });
 
 
 	static const sf::Color selectedColor(255, 255, 0);
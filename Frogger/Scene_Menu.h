@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Scene.h"
+#include "StaticLayer.h"
 
 class Scene_Menu : public Scene
 {
@@ -12,6 +13,7 @@ private:
 	std::string					m_title;
 	sf::Sprite					m_background;
 	sf::Texture m_backgroundTexture;
+	StaticLayer					m_backgroundLayer;
 
 
 	void init();
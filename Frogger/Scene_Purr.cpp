@@ -8,32 +8,51 @@
 #include "Scene_Purr.h"
 #include "Components.h"
 #include "Physics.h"
+#include "EntityCommandBuffer.h"
 #include "Utilities.h"
 #include "MusicPlayer.h"
 #include "Assets.h"
 #include "SoundPlayer.h"
 #include <random>
+#include <algorithm>
 
 namespace {
 	std::random_device rd;
 	std::mt19937 rng(rd());
-}
-const float GRAVITY_SPEED = 150.f;
+
+	const TagId TAG_BKG = EntityManager::internTag("bkg");
+	const TagId TAG_PLAYER = EntityManager::internTag("player");
+	const TagId TAG_INTERACTIVE = EntityManager::internTag("interactiveBox");
+}
+const float GRAVITY = 5400.f;		// px/s^2
+const float JUMP_SPEED = 1200.f;	// px/s
+const float WALK_SPEED = 180.f;		// px/s
+const size_t ENTITY_POOL_SIZE = 256;
+const size_t MOVEMENT_CHUNK_SIZE = 1024;
+const size_t ANIMATION_CHUNK_SIZE = 256;
+const float DEFAULT_CELL_SIZE = 64.f;
+const std::uint16_t SLEEP_FRAMES = 30;
+const float WORLD_FLOOR = 500.f;
+const float GROUND_PROBE_LENGTH = 1000.f;
+const float CULL_MARGIN = 64.f;		// sprites are drawn larger than their AABBs
 
 #pragma region Constructor and Initialization
 Scene_Purr::Scene_Purr(GameEngine* gameEngine, const std::string& levelPath)
 	: Scene(gameEngine)
 	, m_worldView(gameEngine->window().getDefaultView()) {
 
+	m_entityManager.reserve(ENTITY_POOL_SIZE);
+	m_broadphase = Broadphase::create("grid", DEFAULT_CELL_SIZE);
+	initStateMachines();
 	loadLevel(levelPath);
 	registerActions();
+	registerSystems();
 
 	auto pos = m_worldView.getSize();
 
 	pos.x = pos.x / 2.f;
-	pos.y -= 20.f;
+	pos.y = WORLD_FLOOR - 20.f;
 
-	spawnInvisibleCollisionBox();
 	initTexts();
 	spawnPlayer(pos);
 
@@ -62,6 +81,8 @@ void Scene_Purr::loadLevel(const std::string& path) {
 		exit(1);
 	}
 
+	std::vector<StaticCollider> statics;
+
 	std::string token{ "" };
 	config >> token;
 	while (!config.eof()) {
@@ -69,13 +90,25 @@ void Scene_Purr::loadLevel(const std::string& path) {
 			std::string name;
 			sf::Vector2f pos;
 			config >> name >> pos.x >> pos.y;
-			auto e = m_entityManager.addEntity("bkg");
+			auto& e = m_entityManager.addEntity("bkg");
 
 		
-			auto& sprite = e->addComponent<CSprite>(Assets::getInstance().getTexture(name)).sprite;
+			auto& sprite = e.addComponent<CSprite>(Assets::getInstance().getTexture(name)).sprite;
 			sprite.setOrigin(0.f, 0.f);
 			sprite.setPosition(pos);
 		}
+		else if (token == "Static" || token == "Platform") {
+			std::string name;
+			sf::Vector2f pos, size;
+			config >> name >> pos.x >> pos.y >> size.x >> size.y;
+			statics.push_back(StaticCollider{ sf::FloatRect(pos - 0.5f * size, size), token == "Platform" });
+		}
+		else if (token == "Broadphase") {
+			std::string kind;
+			float param;
+			config >> kind >> param;
+			m_broadphase = Broadphase::create(kind, param);
+		}
 		else if (token[0] == '#') {
 			std::cout << token;
 		}
@@ -83,6 +116,9 @@ void Scene_Purr::loadLevel(const std::string& path) {
 		config >> token;
 	}
 	config.close();
+
+	m_staticWorld.build(std::move(statics));
+	m_backgroundLayer.invalidate();
 }
 
 void Scene_Purr::registerActions() {
@@ -102,46 +138,95 @@ void Scene_Purr::registerActions() {
 	registerAction(sf::Keyboard::Space, "ACTIVATE");
 }
 
-void Scene_Purr::spawnPlayer(sf::Vector2f pos) {
-	
-
-	m_player = m_entityManager.addEntity("player");
-	m_player->addComponent<CTransform>(pos);
-	m_player->addComponent<CBoundingBox>(sf::Vector2f(20.f, 20.f));
-	m_player->addComponent<CInput>();
-	m_player->addComponent<CAnimation>(Assets::getInstance().getAnimation("up"));
-	m_player->addComponent<CState>("grounded");
+void Scene_Purr::registerSystems() {
+	using Sched = SystemScheduler;
+
+	// registration order is the order conflicting systems run in. Animation
+	// only touches CAnimation and goes first so it shares a stage with
+	// movement; an animation playerMovement switches to starts next frame.
+	// The rest all write CTransform and run one after the other.
+	m_systems.addSystem("animation",
+		Sched::Reads<>{}, Sched::Writes<CAnimation>{},
+		[this](sf::Time dt) { sAnimation(dt); });
+	m_systems.addSystem("movement",
+		Sched::Reads<CCharacterController, CSleeping>{}, Sched::Writes<CTransform>{},
+		[this](sf::Time dt) { sMovement(dt); });
+	m_systems.addSystem("playerMovement",
+		Sched::Reads<CInput>{}, Sched::Writes<CTransform, CState, CAnimation>{},
+		[this](sf::Time) { playerMovement(); });
+	m_systems.addSystem("characters",
+		Sched::Reads<CBoundingBox, CCollisionFilter>{}, Sched::Writes<CTransform, CCharacterController>{},
+		[this](sf::Time dt) { sCharacters(dt); });
+	// triggers query the broadphase, so they run right after syncing it
+	m_systems.addSystem("broadphase",
+		Sched::Reads<CTransform, CBoundingBox, CTrigger, CSleeping>{}, Sched::Writes<>{},
+		[this](sf::Time) {
+			syncBroadphase();
+			m_triggers.update(m_entityManager, *m_broadphase);
+		});
+	// the broadphase has no component of its own, whoever reads it declares
+	// the components it is built from
+	m_systems.addSystem("collisions",
+		Sched::Reads<CCharacterController, CBoundingBox, CCollisionFilter>{}, Sched::Writes<CTransform, CState>{},
+		[this](sf::Time dt) { sCollisions(dt); });
+
+	// build the match lists now, systems may query them concurrently
+	m_entityManager.view<CTransform>(Without<CSleeping>{});
+	m_entityManager.view<CAnimation>();
+	m_entityManager.view<CTransform, CBoundingBox>(Without<CSleeping>{});
+	m_entityManager.view<CTrigger, CTransform, CBoundingBox>();
+	m_entityManager.view<CCharacterController, CTransform, CBoundingBox>();
+}
+
+void Scene_Purr::initStateMachines() {
+	// player: grounded <-> jumping
+	m_grounded = m_playerStates.addState("grounded", [](Entity& e) {
+		e.getComponent<CTransform>().vel.y = 0;
+		});
+	m_jumping = m_playerStates.addState("jumping");
+	m_jumpEvent = m_playerStates.addEvent("jump");
+	m_fallEvent = m_playerStates.addEvent("fall");
+	m_landEvent = m_playerStates.addEvent("land");
+	m_playerStates.addTransition(m_grounded, m_jumpEvent, m_jumping);
+	m_playerStates.addTransition(m_grounded, m_fallEvent, m_jumping);
+	m_playerStates.addTransition(m_jumping, m_landEvent, m_grounded);
+
+	// interactive boxes: inactive -> active, once
+	m_boxInactive = m_boxStates.addState("inactive");
+	m_boxActive = m_boxStates.addState("active", [this](Entity&) {
+		activatedBoxes++;
+		std::cout << "Activated Boxes: " << activatedBoxes << std::endl;
+		std::cout << "New State of the Box: " << m_boxStates.stateName(m_boxActive) << std::endl;
+		SoundPlayer::getInstance().play("meow");
+		});
+	m_activateEvent = m_boxStates.addEvent("activate");
+	m_boxStates.addTransition(m_boxInactive, m_activateEvent, m_boxActive);
+
+	auto& assets = Assets::getInstance();
+	m_animUp = &assets.getAnimation("up");
+	m_animLeft = &assets.getAnimation("left");
+	m_animRight = &assets.getAnimation("right");
 }
 
-void Scene_Purr::spawnInvisibleCollisionBox() {
-
-	sf::Vector2f viewSize = m_worldView.getSize();
-
-
-	//left
-	m_invisibleCollisionBox = m_entityManager.addEntity("invisibleCollisionBox");
-	m_invisibleCollisionBox->addComponent<CTransform>(sf::Vector2f(110.f, 370.f));
-	m_invisibleCollisionBox->addComponent<CBoundingBox>(sf::Vector2f(135.f, 1.f));
-	m_invisibleCollisionBox->addComponent<CState>("grounded");
-
-	//right
-	m_invisibleCollisionBox = m_entityManager.addEntity("invisibleCollisionBox");
-	m_invisibleCollisionBox->addComponent<CTransform>(sf::Vector2f(910.f, 380.f));
-	m_invisibleCollisionBox->addComponent<CBoundingBox>(sf::Vector2f(115.f, 1.f));
-	m_invisibleCollisionBox->addComponent<CState>("grounded");
+void Scene_Purr::spawnPlayer(sf::Vector2f pos) {
+	
 
-	//bed
-	m_invisibleCollisionBox = m_entityManager.addEntity("invisibleCollisionBox");
-	m_invisibleCollisionBox->addComponent<CTransform>(sf::Vector2f(505.f, 350.f));
-	m_invisibleCollisionBox->addComponent<CBoundingBox>(sf::Vector2f(220.f, 1.f));
-	m_invisibleCollisionBox->addComponent<CState>("grounded");
+	auto& player = m_entityManager.addEntity(TAG_PLAYER);
+	auto& tfm = player.addComponent<CTransform>(pos);
+	auto& box = player.addComponent<CBoundingBox>(sf::Vector2f(20.f, 20.f));
+	player.addComponent<CInput>();
+	auto& filter = player.addComponent<CCollisionFilter>(CollisionFilter::PLAYER, CollisionFilter::GROUND | CollisionFilter::TRIGGER).filter;
+	auto& cc = player.addComponent<CCharacterController>(GRAVITY);
 
-	//drawn a line in the middle of initial position of the player
-	m_invisibleCollisionBox = m_entityManager.addEntity("invisibleCollisionBox");
-	m_invisibleCollisionBox->addComponent<CTransform>(sf::Vector2f(480.f, 490.f));
-	m_invisibleCollisionBox->addComponent<CBoundingBox>(sf::Vector2f(1000.f, 1.f));
-	m_invisibleCollisionBox->addComponent<CState>("grounded");
+	// start out standing on whatever is under the spawn point
+	tfm.pos.y = getGroundLevelAt(tfm.pos, filter.mask) - box.halfSize.y;
+	tfm.prevPos = tfm.pos;
+	m_characters.findGround(tfm, box, cc, filter.mask);
 
+	player.addComponent<CAnimation>(*m_animUp);
+	player.addComponent<CState>(m_playerStates, m_grounded);
+	m_playerAnim = m_animUp;
+	m_player = player.getHandle();
 }
 
 void Scene_Purr::initTexts() {
@@ -262,15 +347,13 @@ void Scene_Purr::update(sf::Time dt) {
 void Scene_Purr::sUpdate(sf::Time dt) {
 	SoundPlayer::getInstance().removeStoppedSounds();
 	m_entityManager.update();
+	for (auto h : m_entityManager.getDestroyed())
+		m_broadphase->remove(h);
 
 	if (m_isPaused)
 		return;
 
-	sAnimation(dt);
-	sMovement(dt);
-	applyGravity(dt);
-	adjustPlayerPosition();
-	sCollisions(dt);
+	m_systems.run(dt, m_game->jobs());
 	
 	m_elapsedTime += dt;
 }
@@ -279,6 +362,9 @@ void Scene_Purr::sUpdate(sf::Time dt) {
 
 #pragma region Events and Actions
 void Scene_Purr::sDoAction(const Command& action) {
+	auto player = m_entityManager.get(m_player);
+	if (!player) return;
+
 	if (action.type() == "START") {
 		if (action.name() == "PAUSE") { setPaused(!m_isPaused); }
 		else if (action.name() == "QUIT") { m_game->quitLevel(); }
@@ -289,26 +375,27 @@ void Scene_Purr::sDoAction(const Command& action) {
 		else if (action.name() == "TOGGLE_GRID") { m_drawGrid = !m_drawGrid; }
 
 
-		if (action.name() == "LEFT") { m_player->getComponent<CInput>().dir = CInput::LEFT; }
-		else if (action.name() == "RIGHT") { m_player->getComponent<CInput>().dir = CInput::RIGHT; }
-		else if (action.name() == "UP") { m_player->getComponent<CInput>().dir = CInput::UP; }
-		else if (action.name() == "DOWN") { m_player->getComponent<CInput>().dir = CInput::DOWN; }
+		if (action.name() == "LEFT") { player->getComponent<CInput>().dir = CInput::LEFT; }
+		else if (action.name() == "RIGHT") { player->getComponent<CInput>().dir = CInput::RIGHT; }
+		else if (action.name() == "UP") { player->getComponent<CInput>().dir = CInput::UP; }
+		else if (action.name() == "DOWN") { player->getComponent<CInput>().dir = CInput::DOWN; }
 
 	}
 
 	else if (action.type() == "END" && (action.name() == "LEFT" || action.name() == "RIGHT" || action.name() == "UP" ||
 		action.name() == "DOWN")) {
-		m_player->getComponent<CInput>().dir = 0;
+		player->getComponent<CInput>().dir = 0;
 	}
 	if (action.type() == "START" && action.name() == "ACTIVATE") {
-		auto& playerTransform = m_player->getComponent<CTransform>();
-		for (auto& box : m_interactiveBoxes) {
-			if (box != nullptr && checkCollision(*m_player, *box)) {
-				box->getComponent<CState>().state = "active";
-				activatedBoxes++;
-				std::cout << "Activated Boxes: " << activatedBoxes << std::endl;
-				std::cout << "New State of the Box: " << box->getComponent<CState>().state << std::endl;
-				SoundPlayer::getInstance().play("meow");
+		m_candidates.clear();
+		m_triggers.getTriggers(m_player, m_candidates);
+		for (auto handle : m_candidates) {
+			auto box = m_entityManager.get(handle);
+			if (box == nullptr || !m_boxStates.fire(*box, m_activateEvent))
+				continue;
+			for (size_t i = 0; i < m_interactiveBoxes.size(); ++i) {
+				if (m_interactiveBoxes[i] == handle)
+					m_boxActivated[i] = true;
 			}
 		}
 	}
@@ -320,94 +407,59 @@ void Scene_Purr::sDoAction(const Command& action) {
 #pragma region Animation and Movement
 
 void Scene_Purr::sMovement(sf::Time dt) {
-	playerMovement();
-
-	for (auto e : m_entityManager.getEntities()) {
-		if (e->hasComponent<CInput>()) continue;
-
-		if (e->hasComponent<CTransform>()) {
-			auto& tfm = e->getComponent<CTransform>();
-			tfm.pos += tfm.vel * dt.asSeconds();
-			tfm.angle += tfm.angVel * dt.asSeconds();
-
-		}
-	}
+	Physics::integrate(m_entityManager, m_game->jobs(), dt, SLEEP_FRAMES, MOVEMENT_CHUNK_SIZE);
 }
 
 void Scene_Purr::sAnimation(sf::Time dt) {
-	auto list = m_entityManager.getEntities();
-	for (auto e : m_entityManager.getEntities()) {
-		if (e->hasComponent<CAnimation>()) {
-			auto& anim = e->getComponent<CAnimation>();
-			anim.animation.update(dt);
-		}
-	}
-}
-
-void Scene_Purr::applyGravity(sf::Time dt) {
-	auto& state = m_player->getComponent<CState>().state;
-	if (state == "jumping") {
-		
-		auto& pos = m_player->getComponent<CTransform>().pos;
-		auto& vel = m_player->getComponent<CTransform>().vel;
-		vel.y += GRAVITY_SPEED * 0.1; 
-		pos.y += vel.y * 0.1; 
-
-		
-		if (isOnGround()) {
-			state = "grounded"; 
-			vel.y = 0; 
-		}
-	}
+	auto view = m_entityManager.view<CAnimation>();
+	m_game->jobs().parallelFor(0, view.size(), ANIMATION_CHUNK_SIZE, [&view, dt](size_t i) {
+		auto [anim] = view[i];
+		anim.animation.update(dt);
+	});
 }
 
-void Scene_Purr::adjustPlayerPosition() {
-	auto center = m_worldView.getCenter();
-	sf::Vector2f viewHalfSize = m_worldView.getSize() / 2.f;
-
-
-	auto left = 25;
-	auto right = 975;
-	auto top = center.y - viewHalfSize.y;
-	auto bot = 500;
-
-	auto& player_pos = m_player->getComponent<CTransform>().pos;
-	auto halfSize = sf::Vector2f{ 20, 20 };
-	player_pos.x = std::max(player_pos.x, left + halfSize.x);
-	player_pos.x = std::min(player_pos.x, right - halfSize.x);
-	player_pos.y = std::max(player_pos.y, top + halfSize.y);
-	player_pos.y = std::min(player_pos.y, bot - halfSize.y);
+void Scene_Purr::sCharacters(sf::Time dt) {
+	m_entityManager.view<CCharacterController, CTransform, CBoundingBox>().each(
+		[this, dt](Entity& e, CCharacterController& cc, CTransform& tfm, CBoundingBox& box) {
+			m_characters.step(tfm, box, cc, Physics::getFilter(e).mask, dt);
+		});
 }
 
 void Scene_Purr::playerMovement() {
-	auto& dir = m_player->getComponent<CInput>().dir;
-	auto& pos = m_player->getComponent<CTransform>().pos;
-	auto& vel = m_player->getComponent<CTransform>().vel;
-	auto& state = m_player->getComponent<CState>().state;
+	auto player = m_entityManager.get(m_player);
+	if (!player) return;
 
+	auto& dir = player->getComponent<CInput>().dir;
+	auto vel = player->getComponent<CTransform>().vel;
+	bool grounded = player->getComponent<CState>().is(m_grounded);
+	const Animation* anim = m_playerAnim;
 
+	vel.x = 0.f;
 	if (dir & CInput::LEFT) {
 
-		pos.x -= 3;
-		if (state == "grounded" || state == "jumping") {
-			m_player->addComponent<CAnimation>(Assets::getInstance().getAnimation("left"));
-		}
+		vel.x = -WALK_SPEED;
+		anim = m_animLeft;
 	}
 	if (dir & CInput::RIGHT) {
 
-		pos.x += 3;
-		if (state == "grounded" || state == "jumping") {
-			m_player->addComponent<CAnimation>(Assets::getInstance().getAnimation("right"));
-		}
+		vel.x = WALK_SPEED;
+		anim = m_animRight;
+	}
+
+	if ((dir & CInput::UP) && grounded) {
+		m_playerStates.fire(*player, m_jumpEvent);
+		vel.y = -JUMP_SPEED;
 	}
 
-	if ((dir & CInput::UP) && state == "grounded") {
-		state = "jumping";
-		vel.y = -200;
+	if (dir == 0 && grounded) {
+		anim = m_animUp;
 	}
+	Physics::setVelocity(*player, vel, m_entityManager.commands());
 
-	if (dir == 0 && state == "grounded") {
-		m_player->addComponent<CAnimation>(Assets::getInstance().getAnimation("up"));
+	// only restart the animation when it actually changes
+	if (anim != m_playerAnim) {
+		player->addComponent<CAnimation>(*anim);
+		m_playerAnim = anim;
 	}
 }
 
@@ -415,28 +467,22 @@ void Scene_Purr::playerMovement() {
 
 #pragma region Collisions
 
-void Scene_Purr::sCollisions(sf::Time dt) {
-	auto& entities = m_entityManager.getEntities();
-	for (auto& entity : entities) {
-		if (entity->getTag() == "player") {
-			auto& playerTransform = entity->getComponent<CTransform>();
-			auto& playerBox = entity->getComponent<CBoundingBox>();
-
-			for (auto& other : entities) {
-				if (entity == other || !other->hasComponent<CBoundingBox>()) continue;
-
-				if (other->getTag() == "invisibleCollisionBox" && checkCollision(*entity, *other)) {
-					entity->getComponent<CState>().state = "grounded";
-					break;
-				}
+void Scene_Purr::syncBroadphase() {
+	// cheap for colliders that stay in their cells or fat AABBs
+	// sleeping entities keep the proxies they had when they fell asleep
+	m_entityManager.view<CTransform, CBoundingBox>(Without<CSleeping>{}).each([this](Entity& e, CTransform& tfm, CBoundingBox& box) {
+		m_broadphase->update(e.getHandle(),
+			sf::FloatRect(tfm.pos.x - box.halfSize.x, tfm.pos.y - box.halfSize.y, box.size.x, box.size.y),
+			Physics::getFilter(e));
+		});
+}
 
-				else {
-					entity->getComponent<CState>().state = "jumping";
-				}
+void Scene_Purr::sCollisions(sf::Time dt) {
+	auto player = m_entityManager.get(m_player);
+	if (!player) return;
 
-			}
-		}
-	}
+	bool grounded = player->getComponent<CCharacterController>().isGrounded();
+	m_playerStates.fire(*player, grounded ? m_landEvent : m_fallEvent);
 }
 
 bool Scene_Purr::checkCollision(Entity& entity1, Entity& entity2) {
@@ -460,50 +506,32 @@ bool Scene_Purr::checkCollision(Entity& entity1, Entity& entity2) {
 	return false;
 }
 
-bool Scene_Purr::isOnGround() const {
-	if (!m_player) return false; 
-
-	auto& transform = m_player->getComponent<CTransform>();
-	auto& boundingBox = m_player->getComponent<CBoundingBox>();
-
-	float groundHeight = 500;
-
-	if ((transform.pos.y + boundingBox.halfSize.y) > groundHeight) {
-		return true;
-	}
-
-
-	return (transform.pos.y + boundingBox.halfSize.y) >= groundHeight;
-}
-
-void Scene_Purr::checkGroundCollision() {
-	if (!m_player) return; 
-
-	auto& transform = m_player->getComponent<CTransform>();
-	auto& boundingBox = m_player->getComponent<CBoundingBox>();
-
-	float groundHeight = 500; 
-
-	if ((transform.pos.y + boundingBox.halfSize.y) > groundHeight) {
-		transform.pos.y = groundHeight - boundingBox.halfSize.y;
-	}
-}
-
 #pragma endregion
 
 #pragma region Render
 
 void Scene_Purr::sRender() {
 	m_game->window().setView(m_worldView);
+	cullEntities();
 	drawBackground();
 	drawEntities();
 
 	if (m_drawAABB) {
-		for (auto& e : m_entityManager.getEntities()) {
-			if (e->hasComponent<CBoundingBox>()) {
-				drawBoundingBox(e);
-			}
+		for (auto handle : m_visible) {
+			auto e = m_entityManager.get(handle);
+			if (e && e->hasComponent<CTransform>() && e->hasComponent<CBoundingBox>())
+				drawBoundingBox(*e);
 		}
+		m_visibleStatics.clear();
+		m_staticWorld.query(getViewBounds(), m_visibleStatics);
+		for (auto i : m_visibleStatics)
+			drawBoundingBox(m_staticWorld.getColliders()[i].bounds);
+
+		auto view = getViewBounds();
+		sf::Text stats("drawn " + std::to_string(m_drawnEntities) + "  culled " + std::to_string(m_culledEntities),
+			Assets::getInstance().getFont("main"), 15);
+		stats.setPosition(view.left + 10.f, view.top + 10.f);
+		m_game->window().draw(stats);
 	}
 
 	textBackground.setSize(sf::Vector2f(displayText.getGlobalBounds().width + 20, displayText.getGlobalBounds().height + 30));
@@ -532,34 +560,86 @@ void Scene_Purr::sRender() {
 }
 
 void Scene_Purr::drawBackground() {
-	for (auto e : m_entityManager.getEntities("bkg")) {
-		if (e->getComponent<CSprite>().has) {
-			m_game->window().draw(e->getComponent<CSprite>().sprite);
+	m_backgroundLayer.draw(m_game->window(), [this](sf::RenderTarget& target) {
+		m_sprites.clear();
+		for (auto e : m_entityManager.getEntities(TAG_BKG)) {
+			if (e->hasComponent<CSprite>()) {
+				m_sprites.add(e->getComponent<CSprite>().sprite);
+			}
+		}
+		m_sprites.draw(target);
+		});
+}
+
+void Scene_Purr::cullEntities() {
+	auto bounds = getViewBounds();
+	bounds.left -= CULL_MARGIN;
+	bounds.top -= CULL_MARGIN;
+	bounds.width += 2.f * CULL_MARGIN;
+	bounds.height += 2.f * CULL_MARGIN;
+
+	// colliders come from the broadphase, sorted so the draw order stays put
+	m_visible.clear();
+	Physics::queryRegion(*m_broadphase, bounds, m_visible);
+	std::sort(m_visible.begin(), m_visible.end());
+
+	// the rest aren't in the broadphase, test their positions
+	m_visibleSprites.clear();
+	m_culledEntities = 0;
+	m_entityManager.view<CAnimation, CTransform>(Without<CBoundingBox>{}).each([&](Entity& e, CAnimation&, CTransform& tfm) {
+		if (!e.isActive())
+			return;
+		if (bounds.contains(tfm.pos))
+			m_visibleSprites.push_back(e.getHandle());
+		else
+			++m_culledEntities;
+		});
+
+	// the broadphase can still hold entities that were destroyed or lost a
+	// component since it was synced, only take what drawEntities can draw.
+	// What is kept is all in the view below, so the difference can't wrap.
+	size_t kept = 0;
+	for (auto handle : m_visible) {
+		auto e = m_entityManager.get(handle);
+		if (e && e->isActive() && e->hasComponent<CAnimation>() && e->hasComponent<CTransform>() && e->hasComponent<CBoundingBox>()) {
+			m_visibleSprites.push_back(handle);
+			++kept;
 		}
 	}
+	m_culledEntities += m_entityManager.view<CAnimation, CTransform, CBoundingBox>().size() - kept;
+	m_drawnEntities = m_visibleSprites.size();
 }
 
 void Scene_Purr::drawEntities() {
-	for (auto& e : m_entityManager.getEntities()) {
-		if (!e->hasComponent<CAnimation>()) continue;
+	// one draw call per texture; sRender draws the AABBs on top afterwards
+	m_sprites.clear();
+	for (auto handle : m_visibleSprites) {
+		auto e = m_entityManager.get(handle);
+		if (!e || !e->isActive() || !e->hasComponent<CTransform>() || !e->hasComponent<CAnimation>()) continue;
 
-		auto& anim = e->getComponent<CAnimation>().animation;
 		auto& tfm = e->getComponent<CTransform>();
-		anim.getSprite().setPosition(tfm.pos);
-		anim.getSprite().setRotation(tfm.angle);
-		m_game->window().draw(anim.getSprite());
-
-		if (m_drawAABB && e->hasComponent<CBoundingBox>()) {
-			drawBoundingBox(e);
-		}
+		auto& sprite = e->getComponent<CAnimation>().animation.getSprite();
+		sprite.setPosition(renderPosition(tfm));
+		sprite.setRotation(tfm.angle);
+		m_sprites.add(sprite);
 	}
+	m_sprites.draw(m_game->window());
 }
 
-void Scene_Purr::drawBoundingBox(std::shared_ptr<Entity> entity) {
-	auto box = entity->getComponent<CBoundingBox>();
-	sf::RectangleShape rect(sf::Vector2f{ box.size.x, box.size.y });
-	centerOrigin(rect);
-	rect.setPosition(entity->getComponent<CTransform>().pos);
+sf::Vector2f Scene_Purr::renderPosition(const CTransform& tfm) const {
+	// prevPos is only refreshed while the simulation runs
+	if (m_isPaused)
+		return tfm.pos;
+	return tfm.prevPos + (tfm.pos - tfm.prevPos) * m_renderAlpha;
+}
+
+void Scene_Purr::drawBoundingBox(Entity& entity) {
+	drawBoundingBox(Physics::getBounds(entity));
+}
+
+void Scene_Purr::drawBoundingBox(const sf::FloatRect& bounds) {
+	sf::RectangleShape rect(sf::Vector2f{ bounds.width, bounds.height });
+	rect.setPosition(bounds.left, bounds.top);
 	rect.setFillColor(sf::Color(0, 0, 0, 0));
 	rect.setOutlineColor(sf::Color{ 0, 255, 0 });
 	rect.setOutlineThickness(2.f);
@@ -698,72 +778,75 @@ void Scene_Purr::onEnd() {
 
 #pragma region Support And Utilities
 
-float Scene_Purr::getGroundLevelAt(float x) {
-	return 500.0f;
+float Scene_Purr::getGroundLevelAt(sf::Vector2f pos, std::uint32_t mask) const {
+	sf::Vector2f down(0.f, GROUND_PROBE_LENGTH);
+	Physics::RayHit hit;
+	if (Physics::raycast(m_staticWorld, pos, down, hit, mask))
+		return pos.y + down.y * hit.time;
+	return WORLD_FLOOR;
 }
 
-sf::FloatRect Scene_Purr::getViewBounds() {
-	return sf::FloatRect();
+sf::FloatRect Scene_Purr::getViewBounds() const {
+	auto size = m_worldView.getSize();
+	return sf::FloatRect(m_worldView.getCenter() - 0.5f * size, size);
 }
 
 void Scene_Purr::spawnInteractiveBoxes(int boxIndex) {
 	if (boxIndex >= m_interactiveBoxes.size()) {
-		m_interactiveBoxes.resize(boxIndex + 1, nullptr);
+		m_interactiveBoxes.resize(boxIndex + 1);
 	}
-	if (m_interactiveBoxes[boxIndex] != nullptr) {
+	if (m_entityManager.isValid(m_interactiveBoxes[boxIndex])) {
 		return;
 	}
 
-	std::shared_ptr<Entity> box = m_entityManager.addEntity("interactiveBox");
+	auto box = &m_entityManager.addEntity(TAG_INTERACTIVE);
 
 	switch (boxIndex) {
 	case 0:
 		box->addComponent<CTransform>(sf::Vector2f(110.f, 370.f));
 		box->addComponent<CBoundingBox>(sf::Vector2f(135.f, 100.f));
-		box->getComponent<CState>().state = "inactive";
+		box->addComponent<CState>(m_boxStates, m_boxInactive);
 
 		break;
 	case 1:
 		box->addComponent<CTransform>(sf::Vector2f(505.f, 350.f));
 		box->addComponent<CBoundingBox>(sf::Vector2f(220.f, 50.f));
-		box->getComponent<CState>().state = "inactive";
+		box->addComponent<CState>(m_boxStates, m_boxInactive);
 
 		break;
 	case 2:
 		box->addComponent<CTransform>(sf::Vector2f(910.f, 380.f));
 		box->addComponent<CBoundingBox>(sf::Vector2f(115.f, 100.f));
-		box->getComponent<CState>().state = "inactive";
+		box->addComponent<CState>(m_boxStates, m_boxInactive);
 
 	}
-	m_interactiveBoxes[boxIndex] = box;
+	box->addComponent<CCollisionFilter>(CollisionFilter::TRIGGER, CollisionFilter::PLAYER);
+	box->addComponent<CTrigger>();
+	m_interactiveBoxes[boxIndex] = box->getHandle();
 }
 
 void Scene_Purr::removeInteractiveBoxes(int boxIndex) {
-	if (boxIndex < m_interactiveBoxes.size() && m_interactiveBoxes[boxIndex] != nullptr) {
-		m_interactiveBoxes[boxIndex]->getComponent<CTransform>().pos = sf::Vector2f(-1000, -1000);
-		m_interactiveBoxes[boxIndex] = nullptr;
+	if (boxIndex >= m_interactiveBoxes.size())
+		return;
+
+	// the broadphase and trigger pairs drop it on the next update
+	if (auto box = m_entityManager.get(m_interactiveBoxes[boxIndex])) {
+		box->destroy();
 	}
+	m_interactiveBoxes[boxIndex] = EntityHandle{};
 }
 
 bool Scene_Purr::checkBox0State() {
-	if (!m_interactiveBoxes.empty() && m_interactiveBoxes[0] != nullptr) {
-		return m_interactiveBoxes[0]->getComponent<CState>().state == "active";
-	}
-	return false;
+	// outlives the box, which is gone by the time the texts ask
+	return m_boxActivated[0];
 }
 
 bool Scene_Purr::checkBox1State() {
-	if (!m_interactiveBoxes.empty() && m_interactiveBoxes[1] != nullptr) {
-		return m_interactiveBoxes[1]->getComponent<CState>().state == "active";
-	}
-	return false;
+	return m_boxActivated[1];
 }
 
 bool Scene_Purr::checkBox2State() {
-	if (!m_interactiveBoxes.empty() && m_interactiveBoxes[2] != nullptr) {
-		return m_interactiveBoxes[2]->getComponent<CState>().state == "active";
-	}
-	return false;
+	return m_boxActivated[2];
 }
 
 #pragma endregion
@@ -10,6 +10,13 @@
 #include "Scene.h"
 #include "GameEngine.h"
 #include "Entity.h"
+#include "StateMachine.h"
+#include "Broadphase.h"
+#include "StaticBvh.h"
+#include "TriggerSystem.h"
+#include "CharacterController.h"
+#include "SpriteBatch.h"
+#include "StaticLayer.h"
 #include <string>
 #include <vector>
 
@@ -37,9 +44,7 @@ private:
 	bool onSafeEntity;
 
 
-	sPtrEntt m_player{ nullptr };
-	sPtrEntt m_invisibleCollisionBox{ nullptr };
-	sPtrEntt m_interactiveBox{ nullptr };
+	EntityHandle m_player;
 	sf::View m_worldView;
 	sf::FloatRect m_worldBounds;
 	sf::Time m_elapsedTime = sf::Time::Zero;
@@ -52,19 +57,46 @@ private:
 	bool m_drawAABB{ false };
 	bool m_drawGrid{ false };
 	bool m_boxCreated[3] = { false, false, false };
+	bool m_boxActivated[3] = { false, false, false };
 	int activatedBoxes = 0;
 
 	int m_score{ 0 };
 	std::unordered_map<std::string, bool> m_laneCrossed;
 	std::unordered_map<int, sf::Time> m_boxLifeTime;
-	std::vector<std::shared_ptr<Entity>> m_interactiveBoxes;
+	std::vector<EntityHandle> m_interactiveBoxes;
+
+	StateMachine m_playerStates;
+	StateId m_grounded, m_jumping;
+	EventId m_jumpEvent, m_fallEvent, m_landEvent;
+	StateMachine m_boxStates;
+	StateId m_boxInactive, m_boxActive;
+	EventId m_activateEvent;
+
+	const Animation* m_animUp{ nullptr };
+	const Animation* m_animLeft{ nullptr };
+	const Animation* m_animRight{ nullptr };
+	const Animation* m_playerAnim{ nullptr };
+
+	std::unique_ptr<Broadphase> m_broadphase;
+	StaticBvh m_staticWorld;
+	CharacterController m_characters{ m_staticWorld };
+	TriggerSystem m_triggers;
+	std::vector<EntityHandle> m_candidates;
+	SpriteBatch m_sprites;
+	std::vector<EntityHandle> m_visible;			// broadphase entities in view, from cullEntities
+	std::vector<EntityHandle> m_visibleSprites;		// the animated ones among them, plus unbounded ones
+	std::vector<std::uint32_t> m_visibleStatics;
+	size_t m_drawnEntities{ 0 };
+	size_t m_culledEntities{ 0 };
+	StaticLayer m_backgroundLayer;
 
 
 	void sMovement(sf::Time dt);
 	void sCollisions(sf::Time dt);
+	void syncBroadphase();
 	void sUpdate(sf::Time dt);
 	void sAnimation(sf::Time dt);
-	void applyGravity(sf::Time dt);
+	void sCharacters(sf::Time dt);
 	void onEnd();
 	
 	sf::RectangleShape fadeOutRect;
@@ -76,9 +108,7 @@ private:
 
 
 	void playerMovement();
-	void adjustPlayerPosition();
-	void spawnInvisibleCollisionBox();
-	float getGroundLevelAt(float x);
+	float getGroundLevelAt(sf::Vector2f pos, std::uint32_t mask = CollisionFilter::ALL) const;
 	void spawnInteractiveBoxes(int boxIndex);
 	void removeInteractiveBoxes(int boxIndex);
 	void initTexts();
@@ -102,16 +132,19 @@ private:
 
 	
 	void drawBackground();
+	void cullEntities();
 	void drawEntities();
-	void drawBoundingBox(std::shared_ptr<Entity>);
-	bool isOnGround() const;
-	void checkGroundCollision();
+	sf::Vector2f renderPosition(const CTransform& tfm) const;
+	void drawBoundingBox(Entity& entity);
+	void drawBoundingBox(const sf::FloatRect& bounds);
 
 	void registerActions();
+	void registerSystems();
+	void initStateMachines();
 
 	void init(const std::string& path);
 	void loadLevel(const std::string& path);
-	sf::FloatRect getViewBounds();
+	sf::FloatRect getViewBounds() const;
 
 public:
 	Scene_Purr(GameEngine* gameEngine, const std::string& levelPath);
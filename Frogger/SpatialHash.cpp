@@ -0,0 +1,264 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+	std::uint64_t cellKey(int x, int y) {
+		return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(y);
+	}
+}
+
+
+SpatialHash::SpatialHash(float cellSize)
+	: m_cellSize(cellSize)
+	, m_invCellSize(1.f / cellSize) {}
+
+
+void SpatialHash::setCellSize(float cellSize) {
+	if (cellSize <= 0.f || cellSize == m_cellSize)
+		return;
+
+	m_cellSize = cellSize;
+	m_invCellSize = 1.f / cellSize;
+
+	m_cells.clear();
+	for (std::uint32_t i = 0; i < m_proxies.size(); ++i) {
+		auto& proxy = m_proxies[i];
+		if (proxy.handle.isNull())
+			continue;
+		proxy.cells = cellsFor(proxy.bounds);
+		link(i, proxy.cells);
+	}
+}
+
+
+float SpatialHash::getCellSize() const {
+	return m_cellSize;
+}
+
+
+SpatialHash::CellRange SpatialHash::cellsFor(const sf::FloatRect& bounds) const {
+	CellRange r;
+	r.x0 = static_cast<int>(std::floor(bounds.left * m_invCellSize));
+	r.y0 = static_cast<int>(std::floor(bounds.top * m_invCellSize));
+	r.x1 = static_cast<int>(std::floor((bounds.left + bounds.width) * m_invCellSize));
+	r.y1 = static_cast<int>(std::floor((bounds.top + bounds.height) * m_invCellSize));
+	return r;
+}
+
+
+void SpatialHash::link(std::uint32_t proxy, const CellRange& cells) {
+	for (int y = cells.y0; y <= cells.y1; ++y) {
+		for (int x = cells.x0; x <= cells.x1; ++x)
+			m_cells[cellKey(x, y)].push_back(proxy);
+	}
+}
+
+
+void SpatialHash::unlink(std::uint32_t proxy, const CellRange& cells) {
+	for (int y = cells.y0; y <= cells.y1; ++y) {
+		for (int x = cells.x0; x <= cells.x1; ++x) {
+			auto it = m_cells.find(cellKey(x, y));
+			if (it == m_cells.end())
+				continue;
+
+			auto& cell = it->second;
+			auto pos = std::find(cell.begin(), cell.end(), proxy);
+			if (pos != cell.end()) {
+				*pos = cell.back();
+				cell.pop_back();
+			}
+			if (cell.empty())
+				m_cells.erase(it);
+		}
+	}
+}
+
+
+void SpatialHash::update(EntityHandle h, const sf::FloatRect& bounds, const CollisionFilter& filter) {
+	if (h.index >= m_proxies.size())
+		m_proxies.resize(h.index + 1);
+
+	auto& proxy = m_proxies[h.index];
+	auto cells = cellsFor(bounds);
+
+	// slot reused by a new entity, drop the stale entry first
+	if (!proxy.handle.isNull() && proxy.handle != h)
+		remove(proxy.handle);
+
+	if (proxy.handle.isNull()) {
+		proxy.handle = h;
+		proxy.cells = cells;
+		link(h.index, cells);
+		++m_count;
+	}
+	else if (!(proxy.cells == cells)) {
+		unlink(h.index, proxy.cells);
+		link(h.index, cells);
+		proxy.cells = cells;
+	}
+	proxy.bounds = bounds;
+	proxy.filter = filter;
+}
+
+
+void SpatialHash::remove(EntityHandle h) {
+	if (!contains(h))
+		return;
+
+	auto& proxy = m_proxies[h.index];
+	unlink(h.index, proxy.cells);
+	proxy = Proxy{};
+	--m_count;
+}
+
+
+bool SpatialHash::contains(EntityHandle h) const {
+	return h.index < m_proxies.size() && m_proxies[h.index].handle == h;
+}
+
+
+sf::FloatRect SpatialHash::getBounds(EntityHandle h) const {
+	return m_proxies[h.index].bounds;
+}
+
+
+void SpatialHash::clear() {
+	m_cells.clear();
+	m_proxies.clear();
+	m_count = 0;
+}
+
+
+size_t SpatialHash::size() const {
+	return m_count;
+}
+
+
+std::uint32_t SpatialHash::nextStamp() {
+	// on wrap-around, forget old stamps so nothing is skipped by accident
+	if (++m_queryStamp == 0) {
+		for (auto& proxy : m_proxies)
+			proxy.stamp = 0;
+		m_queryStamp = 1;
+	}
+	return m_queryStamp;
+}
+
+
+void SpatialHash::query(const sf::FloatRect& bounds, std::vector<EntityHandle>& out, const CollisionFilter& filter) {
+	auto stamp = nextStamp();
+	auto cells = cellsFor(bounds);
+
+	for (int y = cells.y0; y <= cells.y1; ++y) {
+		for (int x = cells.x0; x <= cells.x1; ++x) {
+			auto it = m_cells.find(cellKey(x, y));
+			if (it == m_cells.end())
+				continue;
+
+			for (auto index : it->second) {
+				auto& proxy = m_proxies[index];
+				if (proxy.stamp == stamp)
+					continue;
+				proxy.stamp = stamp;
+				if (filter.accepts(proxy.filter) && proxy.bounds.intersects(bounds))
+					out.push_back(proxy.handle);
+			}
+		}
+	}
+}
+
+
+void SpatialHash::queryPoint(sf::Vector2f p, std::vector<EntityHandle>& out, const CollisionFilter& filter) {
+	auto it = m_cells.find(cellKey(static_cast<int>(std::floor(p.x * m_invCellSize)),
+		static_cast<int>(std::floor(p.y * m_invCellSize))));
+	if (it == m_cells.end())
+		return;
+
+	for (auto index : it->second) {
+		auto& proxy = m_proxies[index];
+		if (filter.accepts(proxy.filter) && proxy.bounds.contains(p))
+			out.push_back(proxy.handle);
+	}
+}
+
+
+void SpatialHash::queryRay(sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out, const CollisionFilter& filter) {
+	auto stamp = nextStamp();
+	auto visit = [&](int x, int y) {
+		auto it = m_cells.find(cellKey(x, y));
+		if (it == m_cells.end())
+			return;
+
+		for (auto index : it->second) {
+			auto& proxy = m_proxies[index];
+			if (proxy.stamp == stamp)
+				continue;
+			proxy.stamp = stamp;
+
+			RayHit hit;
+			if (filter.accepts(proxy.filter) && intersectRay(proxy.bounds, origin, delta, hit)) {
+				hit.handle = proxy.handle;
+				out.push_back(hit);
+			}
+		}
+	};
+
+	// grid DDA: steps from cell to cell along the segment, so only the
+	// cells it crosses are looked at (Amanatides & Woo)
+	auto start = cellsFor(sf::FloatRect(origin, sf::Vector2f(0.f, 0.f)));
+	auto end = cellsFor(sf::FloatRect(origin + delta, sf::Vector2f(0.f, 0.f)));
+	int x = start.x0, y = start.y0;
+	int stepX = delta.x > 0.f ? 1 : -1;
+	int stepY = delta.y > 0.f ? 1 : -1;
+
+	// ray parameter at the next cell boundary on each axis, and per cell
+	constexpr float never = std::numeric_limits<float>::infinity();
+	float tMaxX = never, tMaxY = never, tDeltaX = never, tDeltaY = never;
+	if (delta.x != 0.f) {
+		tMaxX = ((x + (stepX > 0 ? 1 : 0)) * m_cellSize - origin.x) / delta.x;
+		tDeltaX = m_cellSize / std::abs(delta.x);
+	}
+	if (delta.y != 0.f) {
+		tMaxY = ((y + (stepY > 0 ? 1 : 0)) * m_cellSize - origin.y) / delta.y;
+		tDeltaY = m_cellSize / std::abs(delta.y);
+	}
+
+	// never steps past the end cell on an axis, so rounding can't run away.
+	// Entities are linked into every cell their closed box touches, so
+	// passing a corner through either side cell misses nothing.
+	visit(x, y);
+	while (x != end.x0 || y != end.y0) {
+		if (y == end.y0 || (x != end.x0 && tMaxX < tMaxY)) {
+			x += stepX;
+			tMaxX += tDeltaX;
+		}
+		else {
+			y += stepY;
+			tMaxY += tDeltaY;
+		}
+		visit(x, y);
+	}
+}
+
+
+void SpatialHash::queryPairs(std::vector<Pair>& out) {
+	for (auto& [key, cell] : m_cells) {
+		int x = static_cast<int>(static_cast<std::uint32_t>(key >> 32));
+		int y = static_cast<int>(static_cast<std::uint32_t>(key));
+
+		for (size_t i = 0; i < cell.size(); ++i) {
+			auto& a = m_proxies[cell[i]];
+			for (size_t j = i + 1; j < cell.size(); ++j) {
+				auto& b = m_proxies[cell[j]];
+
+				// a pair sharing several cells is reported by the first of them only
+				if (x != std::max(a.cells.x0, b.cells.x0) || y != std::max(a.cells.y0, b.cells.y0))
+					continue;
+				if (a.filter.accepts(b.filter) && a.bounds.intersects(b.bounds))
+					out.emplace_back(a.handle, b.handle);
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Broadphase.h"
+
+
+// Uniform grid broadphase. Every entity is stored in each cell its AABB
+// touches; queries only look at the cells under the query rectangle, and
+// rays at the cells they cross.
+//
+// Entries are indexed by entity slot. update() is cheap when an entity stays
+// in the same cells, so it can be called for every collider every frame.
+// Queries are not safe to run concurrently with each other or with updates.
+class SpatialHash : public Broadphase
+{
+private:
+	struct CellRange {
+		int x0{ 0 }, y0{ 0 }, x1{ -1 }, y1{ -1 };
+
+		bool operator==(const CellRange& o) const {
+			return x0 == o.x0 && y0 == o.y0 && x1 == o.x1 && y1 == o.y1;
+		}
+	};
+
+	struct Proxy {
+		EntityHandle    handle;
+		sf::FloatRect   bounds;
+		CollisionFilter filter;
+		CellRange       cells;
+		std::uint32_t   stamp{ 0 };
+	};
+
+	using Cell = std::vector<std::uint32_t>;        // proxy indices
+
+	float                                       m_cellSize;
+	float                                       m_invCellSize;
+	std::unordered_map<std::uint64_t, Cell>     m_cells;
+	std::vector<Proxy>                          m_proxies;      // indexed by EntityHandle::index
+	size_t                                      m_count{ 0 };
+	std::uint32_t                               m_queryStamp{ 0 };
+
+	CellRange       cellsFor(const sf::FloatRect& bounds) const;
+	void            link(std::uint32_t proxy, const CellRange& cells);
+	void            unlink(std::uint32_t proxy, const CellRange& cells);
+	std::uint32_t   nextStamp();
+
+public:
+	explicit SpatialHash(float cellSize = 64.f);
+
+	// re-buckets everything already inserted
+	void            setCellSize(float cellSize);
+	float           getCellSize() const;
+
+	void            update(EntityHandle h, const sf::FloatRect& bounds, const CollisionFilter& filter = {}) override;
+	void            remove(EntityHandle h) override;
+	bool            contains(EntityHandle h) const override;
+	sf::FloatRect   getBounds(EntityHandle h) const override;
+	void            clear() override;
+	size_t          size() const override;
+
+	void            query(const sf::FloatRect& bounds, std::vector<EntityHandle>& out,
+		const CollisionFilter& filter = {}) override;
+	void            queryPoint(sf::Vector2f p, std::vector<EntityHandle>& out,
+		const CollisionFilter& filter = {}) override;
+	void            queryRay(sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out,
+		const CollisionFilter& filter = {}) override;
+	void            queryPairs(std::vector<Pair>& out) override;
+};
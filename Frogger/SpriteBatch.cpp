@@ -0,0 +1,84 @@
+#include "SpriteBatch.h"
+#include <cstdlib>
+
+
+SpriteBatch::Batch& SpriteBatch::batchFor(const sf::Texture& texture) {
+	// consecutive sprites usually share a texture
+	if (m_last < m_used && m_batches[m_last].texture == &texture)
+		return m_batches[m_last];
+
+	for (m_last = 0; m_last < m_used; ++m_last) {
+		if (m_batches[m_last].texture == &texture)
+			return m_batches[m_last];
+	}
+
+	if (m_used == m_batches.size())
+		m_batches.emplace_back();
+	m_last = m_used++;
+	m_batches[m_last].texture = &texture;
+	return m_batches[m_last];
+}
+
+
+void SpriteBatch::clear() {
+	for (size_t i = 0; i < m_used; ++i) {
+		m_batches[i].texture = nullptr;
+		m_batches[i].vertices.clear();
+	}
+	m_used = 0;
+	m_last = 0;
+	m_quads = 0;
+}
+
+
+void SpriteBatch::add(const sf::Sprite& sprite) {
+	if (sprite.getTexture() == nullptr)
+		return;
+	add(*sprite.getTexture(), sprite.getTextureRect(), sprite.getTransform(), sprite.getColor());
+}
+
+
+void SpriteBatch::add(const sf::Texture& texture, const sf::IntRect& rect, const sf::Transform& transform,
+	const sf::Color& color) {
+	auto& vertices = batchFor(texture).vertices;
+
+	// local corners are the texture rect's size, like sf::Sprite
+	float w = static_cast<float>(std::abs(rect.width));
+	float h = static_cast<float>(std::abs(rect.height));
+	sf::Vector2f p0 = transform.transformPoint(sf::Vector2f(0.f, 0.f));
+	sf::Vector2f p1 = transform.transformPoint(sf::Vector2f(w, 0.f));
+	sf::Vector2f p2 = transform.transformPoint(sf::Vector2f(w, h));
+	sf::Vector2f p3 = transform.transformPoint(sf::Vector2f(0.f, h));
+
+	float left = static_cast<float>(rect.left);
+	float top = static_cast<float>(rect.top);
+	float right = left + static_cast<float>(rect.width);
+	float bottom = top + static_cast<float>(rect.height);
+	sf::Vector2f t0(left, top), t1(right, top), t2(right, bottom), t3(left, bottom);
+
+	vertices.append(sf::Vertex(p0, color, t0));
+	vertices.append(sf::Vertex(p1, color, t1));
+	vertices.append(sf::Vertex(p2, color, t2));
+	vertices.append(sf::Vertex(p0, color, t0));
+	vertices.append(sf::Vertex(p2, color, t2));
+	vertices.append(sf::Vertex(p3, color, t3));
+	++m_quads;
+}
+
+
+void SpriteBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+	for (size_t i = 0; i < m_used; ++i) {
+		states.texture = m_batches[i].texture;
+		target.draw(m_batches[i].vertices, states);
+	}
+}
+
+
+size_t SpriteBatch::getQuadCount() const {
+	return m_quads;
+}
+
+
+size_t SpriteBatch::getDrawCalls() const {
+	return m_used;
+}
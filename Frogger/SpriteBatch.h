@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+
+
+// Collects textured quads into one vertex array per texture and draws each
+// array with a single call. Sprites sharing a texture are drawn in the
+// order they were added; different textures are drawn in the order they
+// first appeared, so only batch sprites that don't need to interleave.
+// clear() keeps the arrays' storage for the next frame.
+class SpriteBatch
+{
+private:
+	struct Batch {
+		const sf::Texture*  texture{ nullptr };
+		sf::VertexArray     vertices{ sf::Triangles };
+	};
+
+	std::vector<Batch>  m_batches;
+	size_t              m_used{ 0 };        // batches with a texture this frame
+	size_t              m_last{ 0 };        // batch the previous add() went to
+	size_t              m_quads{ 0 };
+
+	Batch&          batchFor(const sf::Texture& texture);
+
+public:
+	void            clear();
+
+	// the sprite's texture rect, transform and colour, as sf::Sprite draws it
+	void            add(const sf::Sprite& sprite);
+	void            add(const sf::Texture& texture, const sf::IntRect& rect, const sf::Transform& transform,
+		const sf::Color& color = sf::Color::White);
+
+	void            draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) const;
+
+	size_t          getQuadCount() const;
+	size_t          getDrawCalls() const;
+};
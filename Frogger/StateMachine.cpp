@@ -0,0 +1,69 @@
+#include "StateMachine.h"
+#include "Entity.h"
+#include <stdexcept>
+
+
+StateId StateMachine::addState(const std::string& name, Hook onEnter, Hook onExit) {
+	if (m_states.size() >= None)
+		throw std::runtime_error("Too many states in state machine - " + name);
+
+	m_states.push_back(State{ name, std::move(onEnter), std::move(onExit),
+		std::vector<StateId>(m_events.size(), None) });
+	return static_cast<StateId>(m_states.size() - 1);
+}
+
+
+EventId StateMachine::addEvent(const std::string& name) {
+	m_events.push_back(name);
+	for (auto& s : m_states)
+		s.next.push_back(None);
+	return static_cast<EventId>(m_events.size() - 1);
+}
+
+
+void StateMachine::addTransition(StateId from, EventId event, StateId to) {
+	m_states.at(from).next.at(event) = to;
+}
+
+
+StateId StateMachine::state(const std::string& name) const {
+	for (size_t i = 0; i < m_states.size(); ++i) {
+		if (m_states[i].name == name)
+			return static_cast<StateId>(i);
+	}
+	throw std::runtime_error("Unknown state - " + name);
+}
+
+
+EventId StateMachine::event(const std::string& name) const {
+	for (size_t i = 0; i < m_events.size(); ++i) {
+		if (m_events[i] == name)
+			return static_cast<EventId>(i);
+	}
+	throw std::runtime_error("Unknown event - " + name);
+}
+
+
+const std::string& StateMachine::stateName(StateId state) const {
+	return m_states.at(state).name;
+}
+
+
+StateId StateMachine::next(StateId from, EventId event) const {
+	return m_states[from].next[event];
+}
+
+
+bool StateMachine::fire(Entity& e, EventId event) const {
+	auto& cstate = e.getComponent<CState>();
+	auto to = next(cstate.state, event);
+	if (to == None)
+		return false;
+
+	if (auto& onExit = m_states[cstate.state].onExit)
+		onExit(e);
+	cstate.state = to;
+	if (auto& onEnter = m_states[to].onEnter)
+		onEnter(e);
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Entity;
+
+using StateId = std::uint8_t;
+using EventId = std::uint8_t;
+
+
+// Shared definition of a finite state machine: named states and events,
+// a (state, event) -> state transition table and optional enter/exit hooks.
+// Names are resolved to ids once while the scene loads; entities carry only
+// a CState pointing at the machine and their current StateId.
+class StateMachine
+{
+public:
+	using Hook = std::function<void(Entity&)>;
+
+	static constexpr StateId None = 0xFF;
+
+private:
+	struct State {
+		std::string             name;
+		Hook                    onEnter;
+		Hook                    onExit;
+		std::vector<StateId>    next;       // indexed by EventId
+	};
+
+	std::vector<State>          m_states;
+	std::vector<std::string>    m_events;
+
+public:
+	StateId                     addState(const std::string& name, Hook onEnter = {}, Hook onExit = {});
+	EventId                     addEvent(const std::string& name);
+	void                        addTransition(StateId from, EventId event, StateId to);
+
+	StateId                     state(const std::string& name) const;
+	EventId                     event(const std::string& name) const;
+	const std::string&          stateName(StateId state) const;
+
+	StateId                     next(StateId from, EventId event) const;
+
+	// Moves e's CState along event if the table allows it, running the exit
+	// hook of the old state and the enter hook of the new one.
+	bool                        fire(Entity& e, EventId event) const;
+};
@@ -0,0 +1,159 @@
+#include "StaticBvh.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+	sf::FloatRect unite(const sf::FloatRect& a, const sf::FloatRect& b) {
+		float left = std::min(a.left, b.left);
+		float top = std::min(a.top, b.top);
+		float right = std::max(a.left + a.width, b.left + b.width);
+		float bottom = std::max(a.top + a.height, b.top + b.height);
+		return sf::FloatRect(left, top, right - left, bottom - top);
+	}
+
+	// inclusive, so a ray's zero width sweep still reaches the nodes it crosses
+	bool touches(const sf::FloatRect& a, const sf::FloatRect& b) {
+		return a.left <= b.left + b.width && b.left <= a.left + a.width
+			&& a.top <= b.top + b.height && b.top <= a.top + a.height;
+	}
+}
+
+
+void StaticBvh::build(std::vector<StaticCollider> colliders) {
+	m_colliders = std::move(colliders);
+	m_nodes.clear();
+	if (m_colliders.empty())
+		return;
+
+	m_nodes.reserve(2 * m_colliders.size());
+	buildNode(0, static_cast<std::uint32_t>(m_colliders.size()), 0);
+	m_nodes.shrink_to_fit();
+}
+
+
+void StaticBvh::buildNode(std::uint32_t first, std::uint32_t count, std::uint32_t depth) {
+	auto begin = m_colliders.begin() + first;
+	auto end = begin + count;
+
+	Node node;
+	node.bounds = begin->bounds;
+	for (auto it = begin + 1; it != end; ++it)
+		node.bounds = unite(node.bounds, it->bounds);
+
+	auto index = m_nodes.size();
+	m_nodes.push_back(node);
+	if (count <= LeafSize || depth + 1 >= MaxDepth) {
+		m_nodes[index].first = first;
+		m_nodes[index].count = count;
+		return;
+	}
+
+	// median split along the longer axis keeps the depth logarithmic
+	bool splitX = node.bounds.width >= node.bounds.height;
+	auto half = count / 2;
+	std::nth_element(begin, begin + half, end, [splitX](const StaticCollider& ca, const StaticCollider& cb) {
+		auto& a = ca.bounds;
+		auto& b = cb.bounds;
+		return splitX ? a.left + 0.5f * a.width < b.left + 0.5f * b.width
+			: a.top + 0.5f * a.height < b.top + 0.5f * b.height;
+	});
+
+	buildNode(first, half, depth + 1);
+	m_nodes[index].first = static_cast<std::uint32_t>(m_nodes.size());
+	buildNode(first + half, count - half, depth + 1);
+}
+
+
+void StaticBvh::clear() {
+	m_nodes.clear();
+	m_colliders.clear();
+}
+
+
+bool StaticBvh::empty() const {
+	return m_colliders.empty();
+}
+
+
+size_t StaticBvh::size() const {
+	return m_colliders.size();
+}
+
+
+const std::vector<StaticCollider>& StaticBvh::getColliders() const {
+	return m_colliders;
+}
+
+
+void StaticBvh::query(const sf::FloatRect& bounds, std::vector<std::uint32_t>& out, std::uint32_t mask) const {
+	if (m_nodes.empty())
+		return;
+
+	std::array<std::uint32_t, MaxDepth> stack;
+	std::uint32_t top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		auto index = stack[--top];
+		auto& node = m_nodes[index];
+		if (!node.bounds.intersects(bounds))
+			continue;
+
+		if (node.count > 0) {
+			for (auto i = node.first; i < node.first + node.count; ++i) {
+				auto& c = m_colliders[i];
+				if ((c.category & mask) != 0 && c.bounds.intersects(bounds))
+					out.push_back(i);
+			}
+		}
+		else {
+			stack[top++] = node.first;
+			stack[top++] = index + 1;
+		}
+	}
+}
+
+
+bool StaticBvh::sweep(const sf::FloatRect& box, sf::Vector2f delta, Physics::SweepHit& hit, std::uint32_t mask) const {
+	if (m_nodes.empty())
+		return false;
+
+	// everything the box passes over on the way
+	sf::FloatRect end(box.left + delta.x, box.top + delta.y, box.width, box.height);
+	auto swept = unite(box, end);
+
+	bool found = false;
+	hit.time = 1.f;
+
+	std::array<std::uint32_t, MaxDepth> stack;
+	std::uint32_t top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		auto index = stack[--top];
+		auto& node = m_nodes[index];
+		if (!touches(node.bounds, swept))
+			continue;
+
+		if (node.count > 0) {
+			for (auto i = node.first; i < node.first + node.count; ++i) {
+				auto& c = m_colliders[i];
+				if ((c.category & mask) == 0)
+					continue;
+				if (c.oneWay && (delta.y <= 0.f || box.top + box.height > c.bounds.top))
+					continue;
+
+				Physics::SweepHit h;
+				if (!Physics::sweep(box, delta, c.bounds, h) || h.time >= hit.time)
+					continue;
+				if (c.oneWay && h.normal.y >= 0.f)
+					continue;
+				hit = h;
+				found = true;
+			}
+		}
+		else {
+			stack[top++] = node.first;
+			stack[top++] = index + 1;
+		}
+	}
+	return found;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Physics.h"
+#include "CollisionFilter.h"
+
+
+struct StaticCollider
+{
+	sf::FloatRect   bounds;
+	bool            oneWay{ false };    // platforms only block from above
+	std::uint32_t   category{ CollisionFilter::GROUND };
+};
+
+
+// Bounding volume hierarchy over the level's static colliders. Built once
+// when the level loads and never changed after that. Nodes are stored flat
+// in depth-first order (the left child directly follows its parent), so
+// queries walk memory mostly forwards and never allocate. Queries only see
+// colliders whose category is in their mask.
+class StaticBvh
+{
+private:
+	static constexpr std::uint32_t LeafSize = 2;
+	static constexpr std::uint32_t MaxDepth = 64;
+
+	struct Node {
+		sf::FloatRect   bounds;
+		std::uint32_t   first{ 0 };     // leaves: first collider, branches: right child
+		std::uint32_t   count{ 0 };     // 0 for branches
+	};
+
+	std::vector<Node>           m_nodes;
+	std::vector<StaticCollider> m_colliders;
+
+	void            buildNode(std::uint32_t first, std::uint32_t count, std::uint32_t depth);
+
+public:
+	void            build(std::vector<StaticCollider> colliders);
+	void            clear();
+
+	bool            empty() const;
+	size_t          size() const;
+	// in tree order, which is what query() indexes
+	const std::vector<StaticCollider>& getColliders() const;
+
+	// appends the index of every collider intersecting bounds
+	void            query(const sf::FloatRect& bounds, std::vector<std::uint32_t>& out,
+		std::uint32_t mask = CollisionFilter::ALL) const;
+	// earliest collider box touches when moved by delta; one-way platforms
+	// only count when box starts above them and moves down
+	bool            sweep(const sf::FloatRect& box, sf::Vector2f delta, Physics::SweepHit& hit,
+		std::uint32_t mask = CollisionFilter::ALL) const;
+};
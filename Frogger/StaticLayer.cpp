@@ -0,0 +1,51 @@
+#include "StaticLayer.h"
+
+
+void StaticLayer::invalidate() {
+	m_dirty = true;
+}
+
+
+bool StaticLayer::isStale(const sf::RenderTarget& target) const {
+	auto& view = target.getView();
+	return m_dirty || target.getSize() != m_size
+		|| view.getCenter() != m_viewCenter || view.getSize() != m_viewSize;
+}
+
+
+void StaticLayer::repaint(const sf::RenderTarget& target, const Painter& paint) {
+	auto& view = target.getView();
+	m_viewCenter = view.getCenter();
+	m_viewSize = view.getSize();
+	m_dirty = false;
+
+	if (target.getSize() != m_size) {
+		m_size = target.getSize();
+		m_cached = m_texture.create(m_size.x, m_size.y);
+	}
+	if (!m_cached)
+		return;
+
+	m_texture.setView(view);
+	m_texture.clear(sf::Color::Transparent);
+	paint(m_texture);
+	m_texture.display();
+	m_sprite.setTexture(m_texture.getTexture(), true);
+}
+
+
+void StaticLayer::draw(sf::RenderTarget& target, const Painter& paint) {
+	if (isStale(target))
+		repaint(target, paint);
+
+	if (!m_cached) {
+		paint(target);
+		return;
+	}
+
+	// the texture is already in window pixels
+	auto view = target.getView();
+	target.setView(sf::View(sf::FloatRect(0.f, 0.f, static_cast<float>(m_size.x), static_cast<float>(m_size.y))));
+	target.draw(m_sprite);
+	target.setView(view);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <functional>
+
+
+// Caches drawing that doesn't change from frame to frame (backgrounds) in
+// a sf::RenderTexture the size of the target, then draws it as a single
+// window sized quad. The layer is painted again only after invalidate(),
+// or when the target's size or view changes. If the render texture can't
+// be created it paints straight to the target every frame instead.
+class StaticLayer
+{
+public:
+	using Painter = std::function<void(sf::RenderTarget&)>;
+
+private:
+	sf::RenderTexture   m_texture;
+	sf::Sprite          m_sprite;
+	sf::Vector2u        m_size{ 0, 0 };
+	sf::Vector2f        m_viewCenter;
+	sf::Vector2f        m_viewSize;
+	bool                m_dirty{ true };
+	bool                m_cached{ false };
+
+	bool                isStale(const sf::RenderTarget& target) const;
+	void                repaint(const sf::RenderTarget& target, const Painter& paint);
+
+public:
+	void                invalidate();
+
+	// paint draws the layer's content with the target's current view
+	void                draw(sf::RenderTarget& target, const Painter& paint);
+};
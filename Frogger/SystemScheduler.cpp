@@ -0,0 +1,73 @@
+#include "SystemScheduler.h"
+#include "JobSystem.h"
+#include <algorithm>
+
+
+void SystemScheduler::addSystem(const std::string& name, ComponentSignature reads, ComponentSignature writes, SystemFn fn) {
+	m_systems.push_back(System{ name, reads, writes, std::move(fn), {} });
+	m_dirty = true;
+}
+
+
+void SystemScheduler::build() {
+	m_stages.clear();
+	std::vector<size_t> depth(m_systems.size(), 0);
+
+	for (size_t j = 0; j < m_systems.size(); ++j) {
+		auto& sys = m_systems[j];
+		sys.dependsOn.clear();
+
+		for (size_t i = 0; i < j; ++i) {
+			auto& earlier = m_systems[i];
+			bool conflict = (earlier.writes & (sys.reads | sys.writes)).any()
+				|| (sys.writes & earlier.reads).any();
+			if (conflict) {
+				sys.dependsOn.push_back(i);
+				depth[j] = std::max(depth[j], depth[i] + 1);
+			}
+		}
+
+		if (depth[j] >= m_stages.size())
+			m_stages.resize(depth[j] + 1);
+		m_stages[depth[j]].push_back(j);
+	}
+	m_dirty = false;
+}
+
+
+void SystemScheduler::run(sf::Time dt, JobSystem& jobs) {
+	if (m_dirty)
+		build();
+
+	// systems are numbered by registration, whichever thread runs them
+	auto runSystem = [this, dt](size_t system) {
+		JobSystem::WorkScope scope(JobSystem::WorkId{ static_cast<std::uint32_t>(system + 1), 0 });
+		m_systems[system].fn(dt);
+	};
+
+	for (auto& stage : m_stages) {
+		if (stage.size() == 1) {
+			runSystem(stage.front());
+			continue;
+		}
+
+		// hand off all but one system, run that one on this thread
+		JobSystem::Counter counter;
+		for (size_t k = 1; k < stage.size(); ++k)
+			jobs.submit(counter, [&runSystem, system = stage[k]] { runSystem(system); });
+		runSystem(stage.front());
+		jobs.wait(counter);
+	}
+}
+
+
+const std::vector<std::vector<size_t>>& SystemScheduler::getStages() {
+	if (m_dirty)
+		build();
+	return m_stages;
+}
+
+
+const std::string& SystemScheduler::getName(size_t system) const {
+	return m_systems[system].name;
+}
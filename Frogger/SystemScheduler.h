@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SFML/System/Time.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Components.h"
+
+class JobSystem;
+
+
+// Runs a scene's update systems. Each system declares the components it
+// reads and writes; a system depends on every earlier-registered system it
+// conflicts with (write/write or read/write on the same component). Systems
+// are grouped into stages by dependency depth and each stage runs its
+// systems concurrently on the JobSystem.
+class SystemScheduler
+{
+public:
+	using SystemFn = std::function<void(sf::Time)>;
+
+	template<typename... Ts> struct Reads {};
+	template<typename... Ts> struct Writes {};
+
+private:
+	struct System {
+		std::string             name;
+		ComponentSignature      reads;
+		ComponentSignature      writes;
+		SystemFn                fn;
+		std::vector<size_t>     dependsOn;
+	};
+
+	std::vector<System>                 m_systems;
+	std::vector<std::vector<size_t>>    m_stages;
+	bool                                m_dirty{ true };
+
+	void                                build();
+
+public:
+	template<typename... R, typename... W>
+	void addSystem(const std::string& name, Reads<R...>, Writes<W...>, SystemFn fn) {
+		addSystem(name, componentSignature<R...>(), componentSignature<W...>(), std::move(fn));
+	}
+
+	void addSystem(const std::string& name, ComponentSignature reads, ComponentSignature writes, SystemFn fn);
+
+	void                                run(sf::Time dt, JobSystem& jobs);
+	const std::vector<std::vector<size_t>>& getStages();
+	const std::string&                  getName(size_t system) const;
+};
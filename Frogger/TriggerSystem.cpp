@@ -0,0 +1,152 @@
+#include "TriggerSystem.h"
+#include "Broadphase.h"
+#include "EntityManager.h"
+#include "EntityCommandBuffer.h"
+#include "Physics.h"
+#include <algorithm>
+
+
+void TriggerSystem::update(EntityManager& entities, Broadphase& broadphase) {
+	std::swap(m_pairs, m_previous);
+	m_pairs.clear();
+	m_events.clear();
+
+	// only bodies that moved past the threshold can change their pairs
+	m_moved.clear();
+	entities.view<CTransform, CBoundingBox>(Without<CSleeping>{}).each([&](Entity& e, CTransform&, CBoundingBox&) {
+		if (m_contacts.moved(e))
+			m_moved.push_back(e.getHandle());
+		});
+	std::sort(m_moved.begin(), m_moved.end());
+
+	// the rest keep theirs without a query
+	for (auto& pair : m_previous) {
+		if (!isMoved(pair.first) && !isMoved(pair.second) && entities.get(pair.first) && entities.get(pair.second))
+			m_pairs.push_back(pair);
+	}
+
+	for (auto handle : m_moved)
+		findPairs(entities, broadphase, *entities.get(handle));
+	std::sort(m_pairs.begin(), m_pairs.end());
+
+	// merge the two sorted lists
+	auto prev = m_previous.begin();
+	auto curr = m_pairs.begin();
+	while (prev != m_previous.end() || curr != m_pairs.end()) {
+		if (curr == m_pairs.end() || (prev != m_previous.end() && *prev < *curr)) {
+			m_events.push_back(Event{ Phase::Exit, prev->first, prev->second });
+			++prev;
+		}
+		else if (prev == m_previous.end() || *curr < *prev) {
+			m_events.push_back(Event{ Phase::Enter, curr->first, curr->second });
+			++curr;
+		}
+		else {
+			m_events.push_back(Event{ Phase::Stay, curr->first, curr->second });
+			++prev;
+			++curr;
+		}
+	}
+
+	// kept pairs reuse their contact as it is
+	for (auto& event : m_events) {
+		if (auto contact = m_contacts.find(event.other, event.trigger))
+			event.normal = contact->normal;
+		if (event.phase == Phase::Exit)
+			m_contacts.remove(event.other, event.trigger);
+
+		// a new contact wakes a body a moving trigger ran into, and a
+		// sleeping trigger something walked into
+		if (event.phase == Phase::Enter) {
+			Physics::wake(*entities.get(event.trigger), entities.commands());
+			Physics::wake(*entities.get(event.other), entities.commands());
+		}
+	}
+}
+
+
+void TriggerSystem::findPairs(EntityManager& entities, Broadphase& broadphase, Entity& e) {
+	m_found.clear();
+	Physics::queryOverlaps(broadphase, e, m_found);
+
+	// a moved trigger pairs with everything it touches, any moved body
+	// with the resting triggers it touches; moved triggers find their own
+	bool isTrigger = e.hasComponent<CTrigger>();
+	m_candidates.clear();
+	m_boxes.clear();
+	for (auto handle : m_found) {
+		auto other = entities.get(handle);
+		if (!other)
+			continue;
+
+		Candidate candidate{ other, isTrigger, other->hasComponent<CTrigger>() && !isMoved(handle) };
+		if (candidate.asOther || candidate.asTrigger) {
+			m_candidates.push_back(candidate);
+			m_boxes.push(*other);
+		}
+	}
+
+	// narrowphase over the candidates in one batch
+	auto& tfm = e.getComponent<CTransform>();
+	auto& box = e.getComponent<CBoundingBox>();
+	m_overlapX.resize(m_boxes.size());
+	m_overlapY.resize(m_boxes.size());
+	Physics::getOverlaps(tfm.pos, box.halfSize, m_boxes.span(), Physics::OverlapSpan{ m_overlapX, m_overlapY });
+
+	for (size_t i = 0; i < m_candidates.size(); ++i) {
+		sf::Vector2f overlap(m_overlapX[i], m_overlapY[i]);
+		if (overlap.x <= 0.f || overlap.y <= 0.f)
+			continue;
+
+		auto& other = *m_candidates[i].entity;
+		if (m_candidates[i].asOther) {
+			m_pairs.emplace_back(e.getHandle(), other.getHandle());
+			m_contacts.update(other, e, overlap);
+		}
+		if (m_candidates[i].asTrigger) {
+			m_pairs.emplace_back(other.getHandle(), e.getHandle());
+			m_contacts.update(e, other, overlap);
+		}
+	}
+}
+
+
+bool TriggerSystem::isMoved(EntityHandle h) const {
+	return std::binary_search(m_moved.begin(), m_moved.end(), h);
+}
+
+
+void TriggerSystem::clear() {
+	m_pairs.clear();
+	m_previous.clear();
+	m_events.clear();
+	m_contacts.clear();
+}
+
+
+const std::vector<TriggerSystem::Event>& TriggerSystem::getEvents() const {
+	return m_events;
+}
+
+
+const std::vector<TriggerSystem::Pair>& TriggerSystem::getOverlaps() const {
+	return m_pairs;
+}
+
+
+bool TriggerSystem::isOverlapping(EntityHandle trigger, EntityHandle other) const {
+	return std::binary_search(m_pairs.begin(), m_pairs.end(), Pair{ trigger, other });
+}
+
+
+const Contact* TriggerSystem::getContact(EntityHandle trigger, EntityHandle other) const {
+	return m_contacts.find(other, trigger);
+}
+
+
+void TriggerSystem::getTriggers(EntityHandle other, std::vector<EntityHandle>& out) const {
+	for (auto& [trigger, o] : m_pairs) {
+		if (o == other)
+			out.push_back(trigger);
+	}
+}
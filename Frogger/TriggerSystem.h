@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "EntityHandle.h"
+#include "ContactCache.h"
+#include "Physics.h"
+
+class Broadphase;
+class EntityManager;
+
+
+// Tracks what every CTrigger entity overlaps as sorted (trigger, other)
+// pairs, diffed against the previous update's: new pairs become Enter
+// events, kept pairs Stay, and pairs that vanished (including ones whose
+// entity was destroyed) Exit. Triggers see what their CCollisionFilter
+// mask accepts.
+//
+// Pairs are only looked for again around bodies that moved more than the
+// ContactCache threshold since they last were. Each of those queries the
+// broadphase once and runs the candidates through the batch overlap
+// kernel; pairs between bodies at rest, sleeping ones included, are kept
+// with their cached contact and cost nothing. A filter or box that changes
+// in place shows up once one of the bodies moves. Enter wakes both
+// bodies if they sleep, see Physics::wake.
+class TriggerSystem
+{
+public:
+	enum class Phase : std::uint8_t { Enter, Stay, Exit };
+
+	struct Event {
+		Phase           phase;
+		EntityHandle    trigger;
+		EntityHandle    other;
+		sf::Vector2f    normal{};   // from the trigger towards other; for exits, the last one seen
+	};
+
+	using Pair = std::pair<EntityHandle, EntityHandle>;   // trigger, other
+
+private:
+	std::vector<Pair>           m_pairs;        // sorted
+	std::vector<Pair>           m_previous;
+	std::vector<Event>          m_events;
+	struct Candidate {
+		Entity*         entity;
+		bool            asOther;        // pairs as (moved trigger, entity)
+		bool            asTrigger;      // pairs as (entity, moved body)
+	};
+
+	std::vector<EntityHandle>   m_moved;        // sorted
+	std::vector<EntityHandle>   m_found;
+	std::vector<Candidate>      m_candidates;   // in m_boxes order
+	Physics::AabbBatch          m_boxes;
+	std::vector<float>          m_overlapX;
+	std::vector<float>          m_overlapY;
+	ContactCache                m_contacts;
+
+	void                        findPairs(EntityManager& entities, Broadphase& broadphase, Entity& e);
+	bool                        isMoved(EntityHandle h) const;
+
+public:
+	void                        update(EntityManager& entities, Broadphase& broadphase);
+	void                        clear();
+
+	// this update's events, in the same order as the pairs
+	const std::vector<Event>&   getEvents() const;
+	// current overlaps, sorted by trigger
+	const std::vector<Pair>&    getOverlaps() const;
+
+	bool                        isOverlapping(EntityHandle trigger, EntityHandle other) const;
+	const Contact*              getContact(EntityHandle trigger, EntityHandle other) const;
+	// appends every trigger other is currently inside
+	void                        getTriggers(EntityHandle other, std::vector<EntityHandle>& out) const;
+};
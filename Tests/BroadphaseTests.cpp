@@ -0,0 +1,54 @@
+#include "Test.h"
+#include "Broadphase.h"
+
+#include <algorithm>
+#include <random>
+
+
+namespace {
+	std::vector<EntityHandle> rayHandles(Broadphase& broadphase, sf::Vector2f origin, sf::Vector2f delta) {
+		std::vector<Broadphase::RayHit> hits;
+		broadphase.queryRay(origin, delta, hits);
+		std::vector<EntityHandle> handles;
+		for (auto& hit : hits)
+			handles.push_back(hit.handle);
+		std::sort(handles.begin(), handles.end());
+		return handles;
+	}
+}
+
+
+// the grid walks the cells under the ray, the tree tests every node the
+// ray touches; both have to find the same entities
+TEST(gridRaysMatchTreeRays) {
+	auto grid = Broadphase::create("grid", 32.f);
+	auto tree = Broadphase::create("tree", 4.f);
+
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> pos(-300.f, 300.f);
+	std::uniform_real_distribution<float> size(1.f, 60.f);
+	for (std::uint32_t i = 0; i < 300; ++i) {
+		sf::FloatRect box(pos(rng), pos(rng), size(rng), size(rng));
+		grid->update(EntityHandle{ i, 0 }, box);
+		tree->update(EntityHandle{ i, 0 }, box);
+	}
+	// edges on grid lines
+	grid->update(EntityHandle{ 300, 0 }, sf::FloatRect(100.f, 40.f, 20.f, 24.f));
+	tree->update(EntityHandle{ 300, 0 }, sf::FloatRect(100.f, 40.f, 20.f, 24.f));
+	grid->update(EntityHandle{ 301, 0 }, sf::FloatRect(20.f, 64.f, 12.f, 10.f));
+	tree->update(EntityHandle{ 301, 0 }, sf::FloatRect(20.f, 64.f, 12.f, 10.f));
+
+	std::vector<std::pair<sf::Vector2f, sf::Vector2f>> rays = {
+		{ { 0.f, 64.f }, { 300.f, 0.f } },      // along a grid line
+		{ { 0.f, 0.f }, { 320.f, 320.f } },     // through cell corners
+		{ { 64.f, -200.f }, { 0.f, 400.f } },
+		{ { 5.f, 5.f }, { 0.f, 0.f } },
+		{ { 250.f, 250.f }, { -500.f, -460.f } },
+	};
+	for (int i = 0; i < 200; ++i)
+		rays.push_back({ { pos(rng), pos(rng) }, { pos(rng), pos(rng) } });
+
+	for (auto& [origin, delta] : rays)
+		CHECK(rayHandles(*grid, origin, delta) == rayHandles(*tree, origin, delta));
+	CHECK(!rayHandles(*grid, { 0.f, 64.f }, { 300.f, 0.f }).empty());
+}
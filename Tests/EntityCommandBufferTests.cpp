@@ -0,0 +1,59 @@
+#include "Test.h"
+#include "EntityManager.h"
+#include "EntityCommandBuffer.h"
+#include "Entity.h"
+#include "JobSystem.h"
+
+
+// every chunk writes the same component of the same entity with the same
+// key; the last chunk has to win however the workers interleave
+TEST(equalKeysPlayBackInChunkOrder) {
+	JobSystem jobs(3);
+	for (int run = 0; run < 20; ++run) {
+		EntityManager entities;
+		auto target = entities.addEntity("a").getHandle();
+		entities.update();
+
+		jobs.parallelFor(0, 64, 4, [&](size_t i) {
+			entities.commands().addComponent(target, CTransform(sf::Vector2f(static_cast<float>(i), 0.f)), 0);
+		});
+		entities.update();
+
+		CHECK(entities.get(target)->getComponent<CTransform>().pos.x == 63.f);
+	}
+}
+
+
+TEST(spawnsComeAfterCommandsOnSlotZero) {
+	EntityManager entities;
+	auto first = entities.addEntity("a").getHandle();
+	entities.update();
+	CHECK(first.index == 0);
+
+	// both keys are 0 and the spawn is recorded first, the destroy still
+	// has to be applied before it
+	bool firstActive = true;
+	entities.commands().spawn(EntityManager::internTag("b"), [&](Entity&) {
+		firstActive = entities.get(first)->isActive();
+		});
+	entities.commands().destroy(first);
+	entities.update();
+
+	CHECK(!firstActive);
+	CHECK(entities.get(first) == nullptr);
+	CHECK(entities.getEntities("b").size() == 1);
+}
+
+
+TEST(buffersOutliveNoManager) {
+	// a new manager never picks up a buffer cached for a destroyed one
+	for (int run = 0; run < 3; ++run) {
+		EntityManager entities;
+		auto e = entities.addEntity("a").getHandle();
+		entities.update();
+		entities.commands().addComponent(e, CSleeping{});
+		entities.update();
+		CHECK(entities.get(e)->hasComponent<CSleeping>());
+		CHECK(entities.commands().empty());
+	}
+}
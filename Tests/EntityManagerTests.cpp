@@ -0,0 +1,43 @@
+#include "Test.h"
+#include "EntityManager.h"
+#include "Entity.h"
+
+#include <string>
+
+
+TEST(tagBucketsSurviveNewTags) {
+	EntityManager entities;
+	entities.addEntity("first");
+	entities.update();
+
+	// a caller iterating one bucket asks for tags nobody has seen yet
+	auto& bucket = entities.getEntities("first");
+	for (auto e : bucket) {
+		for (int i = 0; i < 64; ++i)
+			entities.getEntities("tagBucketsSurviveNewTags" + std::to_string(i));
+		CHECK(e->getTagName() == "first");
+	}
+	CHECK(&bucket == &entities.getEntities("first"));
+	CHECK(bucket.size() == 1);
+}
+
+
+TEST(reservedSpawnBurstKeepsItsStorage) {
+	constexpr size_t Burst = 100;
+	EntityManager entities;
+	entities.reserve(Burst);
+
+	// bucket and match list both come after reserve()
+	auto& bucket = entities.getEntities("reservedSpawnBurst");
+	auto view = entities.view<CTransform>();
+	const auto* bucketData = bucket.data();
+	CHECK(bucket.capacity() >= Burst);
+
+	for (size_t i = 0; i < Burst; ++i)
+		entities.addEntity("reservedSpawnBurst").addComponent<CTransform>();
+	entities.update();
+
+	CHECK(bucket.size() == Burst);
+	CHECK(bucket.data() == bucketData);
+	CHECK(view.size() == Burst);
+}
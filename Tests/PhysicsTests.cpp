@@ -0,0 +1,179 @@
+#include "Test.h"
+#include "Physics.h"
+#include "EntityManager.h"
+#include "EntityCommandBuffer.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+
+namespace {
+	constexpr float Sentinel = 12345.f;
+
+	Physics::AabbBatch randomBoxes(std::mt19937& rng, size_t n) {
+		std::uniform_real_distribution<float> pos(-100.f, 100.f);
+		std::uniform_real_distribution<float> half(0.f, 40.f);
+		Physics::AabbBatch batch;
+		for (size_t i = 0; i < n; ++i)
+			batch.push(sf::Vector2f(pos(rng), pos(rng)), sf::Vector2f(half(rng), half(rng)));
+		return batch;
+	}
+
+	// one spare lane past the end, which no kernel may write
+	struct Result {
+		std::vector<float> x, y;
+
+		explicit Result(size_t n) : x(n + 1, Sentinel), y(n + 1, Sentinel) {}
+		Physics::OverlapSpan span() { return Physics::OverlapSpan{ { x.data(), x.size() - 1 }, { y.data(), y.size() - 1 } }; }
+		bool operator==(const Result& other) const {
+			return std::memcmp(x.data(), other.x.data(), x.size() * sizeof(float)) == 0
+				&& std::memcmp(y.data(), other.y.data(), y.size() * sizeof(float)) == 0;
+		}
+	};
+
+	struct KernelGuard {
+		std::string previous = Physics::getBatchKernel();
+		~KernelGuard() { Physics::setBatchKernel(previous); }
+	};
+}
+
+
+TEST(batchKernelsAgreeOnOddSizes) {
+	KernelGuard guard;
+	auto kernels = Physics::getBatchKernels();
+	CHECK(!kernels.empty());
+	CHECK(std::string(kernels.back()) == "scalar");
+	for (auto name : kernels)
+		std::cout << "  kernel available: " << name << "\n";
+
+	std::mt19937 rng(7);
+	sf::Vector2f center(3.5f, -8.25f), half(12.f, 30.f);
+
+	// every tail length for both the 4 and the 8 wide kernels
+	for (size_t n = 0; n <= 37; ++n) {
+		auto a = randomBoxes(rng, n);
+		auto b = randomBoxes(rng, n);
+
+		CHECK(Physics::setBatchKernel("scalar"));
+		Result oneExpected(n), pairExpected(n);
+		Physics::getOverlaps(center, half, a.span(), oneExpected.span());
+		Physics::getOverlaps(a.span(), b.span(), pairExpected.span());
+
+		for (size_t i = 0; i < n; ++i) {
+			CHECK(oneExpected.x[i] == half.x + a.hx[i] - std::abs(center.x - a.cx[i]));
+			CHECK(oneExpected.y[i] == half.y + a.hy[i] - std::abs(center.y - a.cy[i]));
+			CHECK(pairExpected.x[i] == a.hx[i] + b.hx[i] - std::abs(a.cx[i] - b.cx[i]));
+			CHECK(pairExpected.y[i] == a.hy[i] + b.hy[i] - std::abs(a.cy[i] - b.cy[i]));
+		}
+		CHECK(oneExpected.x[n] == Sentinel && oneExpected.y[n] == Sentinel);
+
+		for (auto name : kernels) {
+			CHECK(Physics::setBatchKernel(name));
+			Result one(n), pair(n);
+			Physics::getOverlaps(center, half, a.span(), one.span());
+			Physics::getOverlaps(a.span(), b.span(), pair.span());
+			CHECK(one == oneExpected);
+			CHECK(pair == pairExpected);
+		}
+	}
+}
+
+
+TEST(unknownBatchKernelIsRefused) {
+	KernelGuard guard;
+	auto before = std::string(Physics::getBatchKernel());
+	CHECK(!Physics::setBatchKernel("neon"));
+	CHECK(before == Physics::getBatchKernel());
+}
+
+
+TEST(sleepingBodyMovesAgainWhenGivenVelocity) {
+	constexpr std::uint16_t SleepFrames = 3;
+	JobSystem jobs(2);
+	EntityManager entities;
+	auto& body = entities.addEntity("body");
+	body.addComponent<CTransform>(sf::Vector2f(10.f, 0.f));
+	auto handle = body.getHandle();
+	entities.update();
+
+	auto step = [&] {
+		Physics::integrate(entities, jobs, sf::seconds(0.5f), SleepFrames, 16);
+		entities.update();
+	};
+	auto& e = *entities.get(handle);
+	for (int i = 0; i < SleepFrames; ++i)
+		step();
+	CHECK(e.hasComponent<CSleeping>());
+
+	Physics::setVelocity(e, sf::Vector2f(4.f, 0.f), entities.commands());
+	entities.update();
+	CHECK(!e.hasComponent<CSleeping>());
+	step();
+	CHECK(e.getComponent<CTransform>().pos == sf::Vector2f(12.f, 0.f));
+
+	// and goes back to sleep once it stops again
+	Physics::setVelocity(e, sf::Vector2f(0.f, 0.f), entities.commands());
+	for (int i = 0; i < SleepFrames; ++i)
+		step();
+	CHECK(e.hasComponent<CSleeping>());
+	CHECK(e.getComponent<CTransform>().pos == sf::Vector2f(12.f, 0.f));
+}
+
+
+// integrate queues the sleep in the frame the body is given a velocity
+TEST(velocityCancelsAPendingSleep) {
+	constexpr std::uint16_t SleepFrames = 3;
+	JobSystem jobs(2);
+	EntityManager entities;
+	auto handle = entities.addEntity("body").getHandle();
+	entities.get(handle)->addComponent<CTransform>(sf::Vector2f(10.f, 0.f));
+	entities.update();
+	auto& e = *entities.get(handle);
+
+	auto integrate = [&] { Physics::integrate(entities, jobs, sf::seconds(0.5f), SleepFrames, 16); };
+	for (int i = 0; i < SleepFrames - 1; ++i) {
+		integrate();
+		entities.update();
+	}
+	integrate();
+	CHECK(!entities.commands().empty());
+
+	Physics::setVelocity(e, sf::Vector2f(4.f, 0.f), entities.commands());
+	entities.update();
+	CHECK(!e.hasComponent<CSleeping>());
+	integrate();
+	CHECK(e.getComponent<CTransform>().pos == sf::Vector2f(12.f, 0.f));
+}
+
+
+// a wake recorded outside any job plays back before the sleep from
+// integrate's jobs, and still wins
+TEST(wakeCancelsAPendingSleep) {
+	constexpr std::uint16_t SleepFrames = 2;
+	JobSystem jobs(2);
+	EntityManager entities;
+	auto handle = entities.addEntity("body").getHandle();
+	entities.get(handle)->addComponent<CTransform>();
+	entities.update();
+	auto& e = *entities.get(handle);
+
+	Physics::integrate(entities, jobs, sf::seconds(0.5f), SleepFrames, 16);
+	entities.update();
+	Physics::integrate(entities, jobs, sf::seconds(0.5f), SleepFrames, 16);
+	Physics::wake(e, entities.commands());
+	entities.update();
+	CHECK(!e.hasComponent<CSleeping>());
+	CHECK(e.getComponent<CTransform>().stillFrames == 0);
+
+	// a body that did fall asleep wakes the same way
+	Physics::integrate(entities, jobs, sf::seconds(0.5f), SleepFrames, 16);
+	entities.update();
+	Physics::integrate(entities, jobs, sf::seconds(0.5f), SleepFrames, 16);
+	entities.update();
+	CHECK(e.hasComponent<CSleeping>());
+	Physics::wake(e, entities.commands());
+	entities.update();
+	CHECK(!e.hasComponent<CSleeping>());
+}
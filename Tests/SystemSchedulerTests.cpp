@@ -0,0 +1,90 @@
+#include "Test.h"
+#include "SystemScheduler.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <map>
+
+
+namespace {
+	using Sched = SystemScheduler;
+
+	// stage of every system, by name
+	std::map<std::string, size_t> stagesOf(SystemScheduler& systems) {
+		std::map<std::string, size_t> result;
+		auto& stages = systems.getStages();
+		for (size_t s = 0; s < stages.size(); ++s) {
+			for (auto system : stages[s])
+				result[systems.getName(system)] = s;
+		}
+		return result;
+	}
+}
+
+
+// same declarations as Scene_Purr::registerSystems
+TEST(scenePurrStages) {
+	SystemScheduler systems;
+	auto none = [](sf::Time) {};
+	systems.addSystem("animation",
+		Sched::Reads<>{}, Sched::Writes<CAnimation>{}, none);
+	systems.addSystem("movement",
+		Sched::Reads<CCharacterController, CSleeping>{}, Sched::Writes<CTransform>{}, none);
+	systems.addSystem("playerMovement",
+		Sched::Reads<CInput>{}, Sched::Writes<CTransform, CState, CAnimation>{}, none);
+	systems.addSystem("characters",
+		Sched::Reads<CBoundingBox, CCollisionFilter>{}, Sched::Writes<CTransform, CCharacterController>{}, none);
+	systems.addSystem("broadphase",
+		Sched::Reads<CTransform, CBoundingBox, CTrigger, CSleeping>{}, Sched::Writes<>{}, none);
+	systems.addSystem("collisions",
+		Sched::Reads<CCharacterController, CBoundingBox, CCollisionFilter>{}, Sched::Writes<CTransform, CState>{}, none);
+
+	auto stages = stagesOf(systems);
+	CHECK(systems.getStages().size() == 5);
+	CHECK(stages["animation"] == 0);
+	CHECK(stages["movement"] == 0);
+	CHECK(stages["playerMovement"] == 1);
+	CHECK(stages["characters"] == 2);
+	CHECK(stages["broadphase"] == 3);
+	CHECK(stages["collisions"] == 4);
+}
+
+
+TEST(readersShareAStage) {
+	SystemScheduler systems;
+	auto none = [](sf::Time) {};
+	systems.addSystem("a", Sched::Reads<CTransform>{}, Sched::Writes<>{}, none);
+	systems.addSystem("b", Sched::Reads<CTransform>{}, Sched::Writes<CAnimation>{}, none);
+	systems.addSystem("c", Sched::Reads<>{}, Sched::Writes<CBoundingBox>{}, none);
+	// reads what a and b read, but c's write comes first
+	systems.addSystem("d", Sched::Reads<CBoundingBox>{}, Sched::Writes<>{}, none);
+	// writes what a reads
+	systems.addSystem("e", Sched::Reads<>{}, Sched::Writes<CTransform>{}, none);
+
+	auto stages = stagesOf(systems);
+	CHECK(stages["a"] == 0);
+	CHECK(stages["b"] == 0);
+	CHECK(stages["c"] == 0);
+	CHECK(stages["d"] == 1);
+	CHECK(stages["e"] == 1);
+}
+
+
+TEST(runCallsEverySystemInStageOrder) {
+	SystemScheduler systems;
+	JobSystem jobs(2);
+	std::atomic<int> step{ 0 };
+	int movedAt = -1, drawnAt = -1, boxedAt = -1;
+
+	systems.addSystem("move", Sched::Reads<>{}, Sched::Writes<CTransform>{},
+		[&](sf::Time) { movedAt = step++; });
+	systems.addSystem("draw", Sched::Reads<CTransform>{}, Sched::Writes<>{},
+		[&](sf::Time) { drawnAt = step++; });
+	systems.addSystem("box", Sched::Reads<>{}, Sched::Writes<CBoundingBox>{},
+		[&](sf::Time) { boxedAt = step++; });
+	systems.run(sf::Time::Zero, jobs);
+
+	CHECK(step == 3);
+	CHECK(movedAt >= 0 && drawnAt > movedAt);
+	CHECK(boxedAt >= 0);
+}
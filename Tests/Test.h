@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+// Just enough of a test framework for the engine code. TEST(name) defines
+// a test that main.cpp runs; a failed CHECK is reported and marks the test
+// failed, but the test carries on.
+namespace test
+{
+	struct Case {
+		const char*     name;
+		void            (*fn)();
+	};
+
+	std::vector<Case>&  cases();
+	void                fail(const char* file, int line, const std::string& what);
+
+	struct Registrar {
+		Registrar(const char* name, void (*fn)()) { cases().push_back(Case{ name, fn }); }
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static test::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(cond) \
+	do { if (!(cond)) test::fail(__FILE__, __LINE__, #cond); } while (0)
@@ -0,0 +1,173 @@
+#include "Test.h"
+#include "TriggerSystem.h"
+#include "SpatialHash.h"
+#include "EntityManager.h"
+#include "Entity.h"
+
+
+namespace {
+	// counts the queries the trigger system makes
+	class CountingBroadphase : public Broadphase
+	{
+	public:
+		SpatialHash     grid{ 64.f };
+		int             queries{ 0 };
+
+		void update(EntityHandle h, const sf::FloatRect& bounds, const CollisionFilter& filter) override { grid.update(h, bounds, filter); }
+		void remove(EntityHandle h) override { grid.remove(h); }
+		bool contains(EntityHandle h) const override { return grid.contains(h); }
+		sf::FloatRect getBounds(EntityHandle h) const override { return grid.getBounds(h); }
+		void clear() override { grid.clear(); }
+		size_t size() const override { return grid.size(); }
+
+		void query(const sf::FloatRect& bounds, std::vector<EntityHandle>& out, const CollisionFilter& filter) override {
+			++queries;
+			grid.query(bounds, out, filter);
+		}
+		void queryPoint(sf::Vector2f p, std::vector<EntityHandle>& out, const CollisionFilter& filter) override {
+			grid.queryPoint(p, out, filter);
+		}
+		void queryRay(sf::Vector2f origin, sf::Vector2f delta, std::vector<RayHit>& out, const CollisionFilter& filter) override {
+			grid.queryRay(origin, delta, out, filter);
+		}
+		void queryPairs(std::vector<Pair>& out) override { grid.queryPairs(out); }
+	};
+
+	struct World {
+		EntityManager       entities;
+		CountingBroadphase  broadphase;
+		TriggerSystem       triggers;
+
+		Entity& add(sf::Vector2f pos, float size, std::uint32_t category, std::uint32_t mask) {
+			auto& e = entities.addEntity("body");
+			e.addComponent<CTransform>(pos);
+			e.addComponent<CBoundingBox>(sf::Vector2f(size, size));
+			e.addComponent<CCollisionFilter>(category, mask);
+			return e;
+		}
+
+		// what Scene_Purr's broadphase system does
+		void step() {
+			entities.update();
+			for (auto h : entities.getDestroyed())
+				broadphase.remove(h);
+			entities.view<CTransform, CBoundingBox>(Without<CSleeping>{}).each([this](Entity& e, CTransform&, CBoundingBox&) {
+				broadphase.update(e.getHandle(), Physics::getBounds(e), Physics::getFilter(e));
+				});
+			broadphase.queries = 0;
+			triggers.update(entities, broadphase);
+		}
+
+		sf::Vector2f& pos(EntityHandle h) { return entities.get(h)->getComponent<CTransform>().pos; }
+	};
+
+	bool onlyEvent(const TriggerSystem& triggers, TriggerSystem::Phase phase, EntityHandle trigger, EntityHandle other) {
+		auto& events = triggers.getEvents();
+		return events.size() == 1 && events[0].phase == phase && events[0].trigger == trigger && events[0].other == other;
+	}
+}
+
+
+TEST(restingPairsSkipTheBroadphase) {
+	World world;
+	auto& box = world.add({ 100.f, 100.f }, 50.f, CollisionFilter::TRIGGER, CollisionFilter::PLAYER);
+	box.addComponent<CTrigger>();
+	auto trigger = box.getHandle();
+	auto player = world.add({ 300.f, 100.f }, 20.f, CollisionFilter::PLAYER, CollisionFilter::TRIGGER).getHandle();
+
+	world.step();
+	CHECK(world.triggers.getEvents().empty());
+	CHECK(world.broadphase.queries == 2);
+
+	// only the player moved, so only the player queries
+	world.pos(player) = { 110.f, 100.f };
+	world.step();
+	CHECK(onlyEvent(world.triggers, TriggerSystem::Phase::Enter, trigger, player));
+	CHECK(world.broadphase.queries == 1);
+	CHECK(world.triggers.getEvents()[0].normal == sf::Vector2f(1.f, 0.f));
+
+	world.step();
+	CHECK(onlyEvent(world.triggers, TriggerSystem::Phase::Stay, trigger, player));
+	CHECK(world.broadphase.queries == 0);
+	CHECK(world.triggers.getEvents()[0].normal == sf::Vector2f(1.f, 0.f));
+
+	// within the threshold
+	world.pos(player).x += 0.3f;
+	world.step();
+	CHECK(onlyEvent(world.triggers, TriggerSystem::Phase::Stay, trigger, player));
+	CHECK(world.broadphase.queries == 0);
+
+	world.pos(player) = { 300.f, 100.f };
+	world.step();
+	CHECK(onlyEvent(world.triggers, TriggerSystem::Phase::Exit, trigger, player));
+	CHECK(world.broadphase.queries == 1);
+	CHECK(!world.triggers.getContact(trigger, player));
+}
+
+
+TEST(creepingBodyStillEntersTrigger) {
+	World world;
+	auto& box = world.add({ 100.f, 100.f }, 50.f, CollisionFilter::TRIGGER, CollisionFilter::PLAYER);
+	box.addComponent<CTrigger>();
+	auto trigger = box.getHandle();
+	auto player = world.add({ 140.f, 100.f }, 20.f, CollisionFilter::PLAYER, CollisionFilter::TRIGGER).getHandle();
+	world.step();
+
+	// steps smaller than the threshold add up
+	bool entered = false;
+	for (int i = 0; i < 40 && !entered; ++i) {
+		world.pos(player).x -= 0.2f;
+		world.step();
+		entered = world.triggers.isOverlapping(trigger, player);
+	}
+	CHECK(entered);
+	CHECK(world.pos(player).x < 135.f);
+	CHECK(world.pos(player).x > 134.f);
+}
+
+
+TEST(movingTriggerFindsSleepingBody) {
+	World world;
+	auto& box = world.add({ 100.f, 100.f }, 50.f, CollisionFilter::TRIGGER, CollisionFilter::ALL);
+	box.addComponent<CTrigger>();
+	auto trigger = box.getHandle();
+	auto sleeper = world.add({ 300.f, 100.f }, 20.f, CollisionFilter::DEFAULT, CollisionFilter::ALL).getHandle();
+	world.step();
+	// asleep after it went into the broadphase, as sMovement does it
+	world.entities.get(sleeper)->addComponent<CSleeping>();
+	world.step();
+
+	world.pos(trigger) = { 290.f, 100.f };
+	world.step();
+	CHECK(onlyEvent(world.triggers, TriggerSystem::Phase::Enter, trigger, sleeper));
+	CHECK(world.entities.get(sleeper)->hasComponent<CSleeping>());
+
+	// the new contact woke it for the next update
+	world.step();
+	CHECK(onlyEvent(world.triggers, TriggerSystem::Phase::Stay, trigger, sleeper));
+	CHECK(!world.entities.get(sleeper)->hasComponent<CSleeping>());
+
+	// resting on a destroyed body ends the pair
+	world.entities.get(sleeper)->destroy();
+	world.step();
+	CHECK(onlyEvent(world.triggers, TriggerSystem::Phase::Exit, trigger, sleeper));
+	CHECK(world.triggers.getOverlaps().empty());
+}
+
+
+TEST(overlappingTriggersPairBothWays) {
+	World world;
+	auto& a = world.add({ 100.f, 100.f }, 50.f, CollisionFilter::TRIGGER, CollisionFilter::TRIGGER);
+	a.addComponent<CTrigger>();
+	auto& b = world.add({ 300.f, 100.f }, 50.f, CollisionFilter::TRIGGER, CollisionFilter::TRIGGER);
+	b.addComponent<CTrigger>();
+	auto ha = a.getHandle(), hb = b.getHandle();
+	world.step();
+
+	// only b moves, a still has to pair with it
+	world.pos(hb) = { 120.f, 100.f };
+	world.step();
+	CHECK(world.triggers.getOverlaps().size() == 2);
+	CHECK(world.triggers.isOverlapping(ha, hb));
+	CHECK(world.triggers.isOverlapping(hb, ha));
+}
@@ -0,0 +1,34 @@
+#include "Test.h"
+
+
+namespace {
+	int g_failures = 0;
+}
+
+
+std::vector<test::Case>& test::cases() {
+	static std::vector<Case> all;
+	return all;
+}
+
+
+void test::fail(const char* file, int line, const std::string& what) {
+	std::cerr << file << "(" << line << "): CHECK(" << what << ") failed\n";
+	++g_failures;
+}
+
+
+int main() {
+	int failed = 0;
+	for (auto& c : test::cases()) {
+		int before = g_failures;
+		c.fn();
+		bool ok = g_failures == before;
+		std::cout << (ok ? "[pass] " : "[FAIL] ") << c.name << "\n";
+		if (!ok)
+			++failed;
+	}
+
+	std::cout << test::cases().size() - failed << "/" << test::cases().size() << " tests passed\n";
+	return failed == 0 ? 0 : 1;
+}